@@ -0,0 +1,237 @@
+#pragma once
+
+#include "../Core/Core.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Syn::Engine {
+	// Epoch based reclamation. Readers enter an epoch before touching shared objects,
+	// writers retire objects instead of freeing them. A retired object is released once
+	// every reader that could still see it has left its epoch.
+	class SYN_API EpochManager {
+	public:
+		static constexpr size_t MaxReaderSlots = 128;
+		static constexpr uint64_t InactiveEpoch = 0;
+
+	private:
+
+		struct alignas(64) ReaderSlot
+		{
+			std::atomic<uint64_t> epoch{ InactiveEpoch };
+			std::atomic<bool> claimed{ false };
+		};
+
+		struct RetiredObject
+		{
+			uint64_t epoch;
+			std::shared_ptr<void> object;
+		};
+
+		struct ThreadRecord
+		{
+			ReaderSlot* slot = nullptr;
+			uint32_t depth = 0;
+
+			~ThreadRecord()
+			{
+				if (slot != nullptr)
+				{
+					slot->epoch.store(InactiveEpoch);
+					slot->claimed.store(false);
+				}
+			}
+		};
+
+		std::atomic<uint64_t> globalEpoch{ 1 };
+		ReaderSlot readerSlots[MaxReaderSlots];
+		// Readers that could not claim a slot, nothing is released while any of them is active
+		std::atomic<uint32_t> unslottedReaders{ 0 };
+
+		std::mutex retiredMutex;
+		std::vector<RetiredObject> retiredObjects;
+		// Size of retiredObjects, read without the lock so readers only collect when something is waiting
+		std::atomic<size_t> retiredCount{ 0 };
+		// Epoch of the last retired object, readers that entered after it never hold anything back
+		std::atomic<uint64_t> newestRetiredEpoch{ 0 };
+
+		static ThreadRecord& LocalRecord()
+		{
+			thread_local ThreadRecord record;
+			return record;
+		}
+
+		ReaderSlot* ClaimSlot()
+		{
+			for (auto& slot : readerSlots)
+			{
+				bool expected = false;
+				if (slot.claimed.compare_exchange_strong(expected, true))
+				{
+					return &slot;
+				}
+			}
+			return nullptr;
+		}
+
+		// Unlocks before the released objects are destroyed
+		void CollectLocked(std::unique_lock<std::mutex>& lock)
+		{
+			std::vector<RetiredObject> released;
+			const uint64_t minimum = MinimumActiveEpoch();
+			auto firstKept = std::partition(retiredObjects.begin(), retiredObjects.end(),
+			                                [minimum](const RetiredObject& retired)
+			                                {
+				                                return retired.epoch < minimum;
+			                                });
+			released.assign(std::make_move_iterator(retiredObjects.begin()), std::make_move_iterator(firstKept));
+			retiredObjects.erase(retiredObjects.begin(), firstKept);
+			retiredCount.store(retiredObjects.size());
+			lock.unlock();
+			// Destructors run outside of the lock
+			released.clear();
+		}
+
+		uint64_t MinimumActiveEpoch()
+		{
+			if (unslottedReaders.load() > 0)
+			{
+				return 0;
+			}
+			uint64_t minimum = UINT64_MAX;
+			for (auto& slot : readerSlots)
+			{
+				const uint64_t epoch = slot.epoch.load();
+				if (epoch != InactiveEpoch && epoch < minimum)
+				{
+					minimum = epoch;
+				}
+			}
+			return minimum;
+		}
+
+	public:
+
+		static EpochManager& Get()
+		{
+			static EpochManager instance;
+			return instance;
+		}
+
+		// No reader is left at static destruction, everything still retired is released here
+		~EpochManager()
+		{
+			std::vector<RetiredObject> released;
+			{
+				std::lock_guard<std::mutex> lock(retiredMutex);
+				released.swap(retiredObjects);
+				retiredCount.store(0);
+			}
+			released.clear();
+		}
+
+		// Nested calls on the same thread keep the outermost epoch
+		void Enter()
+		{
+			ThreadRecord& record = LocalRecord();
+			if (record.depth++ > 0)
+			{
+				return;
+			}
+			if (record.slot == nullptr)
+			{
+				record.slot = ClaimSlot();
+			}
+			if (record.slot != nullptr)
+			{
+				record.slot->epoch.store(globalEpoch.load());
+			}
+			else
+			{
+				unslottedReaders.fetch_add(1);
+			}
+		}
+
+		void Exit()
+		{
+			ThreadRecord& record = LocalRecord();
+			if (record.depth == 0 || --record.depth > 0)
+			{
+				return;
+			}
+			// Unslotted readers hold back every object
+			uint64_t readerEpoch = 0;
+			if (record.slot != nullptr)
+			{
+				readerEpoch = record.slot->epoch.load();
+				record.slot->epoch.store(InactiveEpoch);
+			}
+			else
+			{
+				unslottedReaders.fetch_sub(1);
+			}
+			// Objects retired while this reader was inside would otherwise wait for the next Retire, which may never come.
+			// Never blocks, whoever holds the lock is retiring or collecting already
+			if (retiredCount.load() > 0 && readerEpoch <= newestRetiredEpoch.load())
+			{
+				std::unique_lock<std::mutex> lock(retiredMutex, std::try_to_lock);
+				if (lock.owns_lock())
+				{
+					CollectLocked(lock);
+				}
+			}
+		}
+
+		// Takes over a reference to the object, it is dropped after the grace period
+		void Retire(std::shared_ptr<void> object)
+		{
+			if (!object)
+			{
+				return;
+			}
+			{
+				std::lock_guard<std::mutex> lock(retiredMutex);
+				const uint64_t epoch = globalEpoch.fetch_add(1);
+				retiredObjects.push_back({ epoch, std::move(object) });
+				retiredCount.store(retiredObjects.size());
+				newestRetiredEpoch.store(epoch);
+			}
+			Collect();
+		}
+
+		// Releases every retired object no active reader can still observe.
+		// Runs after Retire, exiting readers only try it when the lock is free, frame loops should call it as well
+		void Collect()
+		{
+			std::unique_lock<std::mutex> lock(retiredMutex);
+			CollectLocked(lock);
+		}
+
+		size_t PendingCount()
+		{
+			std::lock_guard<std::mutex> lock(retiredMutex);
+			return retiredObjects.size();
+		}
+	};
+
+	// Example Usage : EpochGuard guard; if (obj.IsValid()) obj->Func();
+	class EpochGuard {
+	public:
+		EpochGuard()
+		{
+			EpochManager::Get().Enter();
+		}
+
+		~EpochGuard()
+		{
+			EpochManager::Get().Exit();
+		}
+
+		EpochGuard(const EpochGuard&) = delete;
+		EpochGuard& operator=(const EpochGuard&) = delete;
+	};
+}
@@ -6,6 +6,8 @@
 #include <functional>
 #include "../../Runtime/Core/Object.h"
 #include "../../Runtime/Engine/PTR.h"
+#include "../../Runtime/Engine/Epoch.h"
+#include "EventPayloadArena.h"
 
 namespace Syn
 {
@@ -72,6 +74,66 @@ namespace Syn
         }
     };
 
+    /***
+     * P = Payload type, constructed once per Trigger inside an EventPayloadArena
+     * Listeners receive the payload by const reference, it stays valid until the arena is Reset
+    **/
+    template <typename P>
+    class SYN_API PayloadEvent
+    {
+    private:
+        std::vector<void(*)(const P&)> functionReferences;
+
+    public:
+        size_t RefCount()
+        {
+            return functionReferences.size();
+        }
+
+        void Register(void (*ref)(const P&))
+        {
+            functionReferences.push_back(ref);
+        }
+
+        void Unregister(void (*ref)(const P&))
+        {
+            auto found = std::find(functionReferences.begin(), functionReferences.end(), ref);
+            if (found != functionReferences.end())
+            {
+                functionReferences.erase(found);
+            }
+        }
+
+        /**
+         * Example Usage : OnHit.Trigger(frameArena, damage, hitLocation);
+         * Arguments are forwarded to P's constructor
+         **/
+        template <typename... Args>
+        const P& Trigger(EventPayloadArena& arena, Args&&... args)
+        {
+            const P& payload = arena.Emplace<P>(std::forward<Args>(args)...);
+            for (auto ref : functionReferences)
+            {
+                ref(payload);
+            }
+            return payload;
+        }
+
+        PayloadEvent<P>& operator+=(void (*ref)(const P&))
+        {
+            Register(ref);
+
+            return *this;
+        }
+
+        PayloadEvent<P>& operator-=(void (*ref)(const P&))
+        {
+            Unregister(ref);
+
+            return *this;
+        }
+    };
+
     /***
      * T = Potential multiple parameters
     **/
@@ -128,6 +190,8 @@ namespace Syn
 
         void Trigger(T... args)
         {
+            // Objects destroyed on other threads stay alive until the broadcast is done
+            Syn::Engine::EpochGuard epochGuard;
             for (auto& Ref : functionReferences)
             {
                 if (Ref.objRef.IsValid())
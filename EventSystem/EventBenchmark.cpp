@@ -0,0 +1,314 @@
+// Benchmarks for Event, LinkedEvent and PTR against a std::function baseline.
+// Headless, links against Google Benchmark only, see README for how to build and run it.
+
+#include "Event.h"
+#include "PTR.h"
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <vector>
+
+namespace
+{
+    // Counts every allocation made through the global operator new, including std::function and shared_ptr blocks
+    std::atomic<uint64_t> allocationCount{ 0 };
+
+    int64_t listenerSink = 0;
+
+    void CountListener(int value)
+    {
+        listenerSink += value;
+    }
+
+    class BenchmarkListener : public Syn::Core::Object
+    {
+    public:
+        int64_t received = 0;
+
+        void OnEvent(int value)
+        {
+            received += value;
+        }
+    };
+
+    // Allocations of the timed loop per operation, an operation is one listener or one object
+    void ReportAllocations(benchmark::State& state, uint64_t allocationsBefore, int64_t operationsPerIteration)
+    {
+        const uint64_t allocations = allocationCount.load() - allocationsBefore;
+        const double operations = static_cast<double>(state.iterations()) * static_cast<double>(operationsPerIteration);
+        state.counters["allocsPerOp"] = operations > 0 ? static_cast<double>(allocations) / operations : 0.0;
+        state.SetItemsProcessed(static_cast<int64_t>(operations));
+    }
+
+    std::vector<Syn::Engine::PTR<BenchmarkListener>> MakeListeners(int64_t count)
+    {
+        std::vector<Syn::Engine::PTR<BenchmarkListener>> listeners;
+        listeners.reserve(count);
+        for (int64_t i = 0; i < count; i++)
+        {
+            listeners.emplace_back();
+        }
+        return listeners;
+    }
+}
+
+void* operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size ? size : 1))
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+// Event
+
+static void BM_EventRegister(benchmark::State& state)
+{
+    const int64_t listenerCount = state.range(0);
+    const uint64_t allocationsBefore = allocationCount.load();
+    for (auto _ : state)
+    {
+        Syn::Event<int> event;
+        for (int64_t i = 0; i < listenerCount; i++)
+        {
+            event.Register(&CountListener);
+        }
+        benchmark::DoNotOptimize(event.RefCount());
+    }
+    ReportAllocations(state, allocationsBefore, listenerCount);
+}
+
+static void BM_EventUnregister(benchmark::State& state)
+{
+    const int64_t listenerCount = state.range(0);
+    const uint64_t allocationsBefore = allocationCount.load();
+    uint64_t setupAllocations = 0;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        const uint64_t setupStart = allocationCount.load();
+        Syn::Event<int> event;
+        for (int64_t i = 0; i < listenerCount; i++)
+        {
+            event.Register(&CountListener);
+        }
+        setupAllocations += allocationCount.load() - setupStart;
+        state.ResumeTiming();
+
+        for (int64_t i = 0; i < listenerCount; i++)
+        {
+            event.Unregister(&CountListener);
+        }
+        benchmark::DoNotOptimize(event.RefCount());
+    }
+    ReportAllocations(state, allocationsBefore + setupAllocations, listenerCount);
+}
+
+static void BM_EventTrigger(benchmark::State& state)
+{
+    const int64_t listenerCount = state.range(0);
+    Syn::Event<int> event;
+    for (int64_t i = 0; i < listenerCount; i++)
+    {
+        event.Register(&CountListener);
+    }
+    const uint64_t allocationsBefore = allocationCount.load();
+    for (auto _ : state)
+    {
+        event.Trigger(1);
+    }
+    benchmark::DoNotOptimize(listenerSink);
+    ReportAllocations(state, allocationsBefore, listenerCount);
+}
+
+// std::function baseline
+
+static void BM_StdFunctionRegister(benchmark::State& state)
+{
+    const int64_t listenerCount = state.range(0);
+    const uint64_t allocationsBefore = allocationCount.load();
+    for (auto _ : state)
+    {
+        std::vector<std::function<void(int)>> listeners;
+        for (int64_t i = 0; i < listenerCount; i++)
+        {
+            listeners.emplace_back(&CountListener);
+        }
+        benchmark::DoNotOptimize(listeners.size());
+    }
+    ReportAllocations(state, allocationsBefore, listenerCount);
+}
+
+static void BM_StdFunctionTrigger(benchmark::State& state)
+{
+    const int64_t listenerCount = state.range(0);
+    std::vector<std::function<void(int)>> listeners;
+    for (int64_t i = 0; i < listenerCount; i++)
+    {
+        listeners.emplace_back(&CountListener);
+    }
+    const uint64_t allocationsBefore = allocationCount.load();
+    for (auto _ : state)
+    {
+        for (auto& listener : listeners)
+        {
+            listener(1);
+        }
+    }
+    benchmark::DoNotOptimize(listenerSink);
+    ReportAllocations(state, allocationsBefore, listenerCount);
+}
+
+// Bound member functions, the closest std::function equivalent of LinkedEvent
+static void BM_StdFunctionMemberTrigger(benchmark::State& state)
+{
+    const int64_t listenerCount = state.range(0);
+    std::vector<BenchmarkListener> objects(listenerCount);
+    std::vector<std::function<void(int)>> listeners;
+    for (auto& object : objects)
+    {
+        listeners.emplace_back([&object](int value) { object.OnEvent(value); });
+    }
+    const uint64_t allocationsBefore = allocationCount.load();
+    for (auto _ : state)
+    {
+        for (auto& listener : listeners)
+        {
+            listener(1);
+        }
+    }
+    benchmark::DoNotOptimize(objects.data());
+    ReportAllocations(state, allocationsBefore, listenerCount);
+}
+
+// LinkedEvent, range(1) is the percentage of listeners whose PTR was destroyed before the broadcast
+
+static void BM_LinkedEventTrigger(benchmark::State& state)
+{
+    const int64_t listenerCount = state.range(0);
+    const int64_t invalidPercent = state.range(1);
+    auto listeners = MakeListeners(listenerCount);
+    Syn::LinkedEvent<int> event;
+    for (auto& listener : listeners)
+    {
+        event.Register(listener, WRAP_LINKED_EVENT_FUNCTION_ONE_PARAM(&BenchmarkListener::OnEvent, int));
+    }
+    const int64_t invalidCount = listenerCount * invalidPercent / 100;
+    for (int64_t i = 0; i < invalidCount; i++)
+    {
+        listeners[i].Destroy();
+    }
+
+    const uint64_t allocationsBefore = allocationCount.load();
+    for (auto _ : state)
+    {
+        event.Trigger(1);
+    }
+    ReportAllocations(state, allocationsBefore, listenerCount);
+}
+
+static void BM_LinkedEventRegister(benchmark::State& state)
+{
+    const int64_t listenerCount = state.range(0);
+    auto listeners = MakeListeners(listenerCount);
+    const uint64_t allocationsBefore = allocationCount.load();
+    for (auto _ : state)
+    {
+        Syn::LinkedEvent<int> event;
+        for (auto& listener : listeners)
+        {
+            event.Register(listener, WRAP_LINKED_EVENT_FUNCTION_ONE_PARAM(&BenchmarkListener::OnEvent, int));
+        }
+        benchmark::DoNotOptimize(event.RefCount());
+    }
+    ReportAllocations(state, allocationsBefore, listenerCount);
+}
+
+// PTR
+
+static void BM_PTRConstructDestroy(benchmark::State& state)
+{
+    const int64_t objectCount = state.range(0);
+    const uint64_t allocationsBefore = allocationCount.load();
+    for (auto _ : state)
+    {
+        auto listeners = MakeListeners(objectCount);
+        benchmark::DoNotOptimize(listeners.data());
+    }
+    ReportAllocations(state, allocationsBefore, objectCount);
+}
+
+static void BM_PTRCopy(benchmark::State& state)
+{
+    const int64_t objectCount = state.range(0);
+    auto listeners = MakeListeners(objectCount);
+    std::vector<Syn::Engine::PTR<BenchmarkListener>> copies;
+    copies.reserve(objectCount);
+    const uint64_t allocationsBefore = allocationCount.load();
+    for (auto _ : state)
+    {
+        for (auto& listener : listeners)
+        {
+            copies.push_back(listener);
+        }
+        benchmark::DoNotOptimize(copies.data());
+        copies.clear();
+    }
+    ReportAllocations(state, allocationsBefore, objectCount);
+}
+
+// Destroy goes through the EpochManager, objects are released once no reader holds an epoch
+static void BM_PTRDestroy(benchmark::State& state)
+{
+    const int64_t objectCount = state.range(0);
+    const uint64_t allocationsBefore = allocationCount.load();
+    uint64_t setupAllocations = 0;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        const uint64_t setupStart = allocationCount.load();
+        auto listeners = MakeListeners(objectCount);
+        setupAllocations += allocationCount.load() - setupStart;
+        state.ResumeTiming();
+
+        for (auto& listener : listeners)
+        {
+            listener.Destroy();
+        }
+
+        state.PauseTiming();
+        listeners.clear();
+        state.ResumeTiming();
+    }
+    ReportAllocations(state, allocationsBefore + setupAllocations, objectCount);
+}
+
+BENCHMARK(BM_EventRegister)->RangeMultiplier(10)->Range(1, 100000);
+// Unregister erases from the front of the vector, quadratic in the listener count, so it stops at 10k
+BENCHMARK(BM_EventUnregister)->RangeMultiplier(10)->Range(1, 10000);
+BENCHMARK(BM_EventTrigger)->RangeMultiplier(10)->Range(1, 100000);
+BENCHMARK(BM_StdFunctionRegister)->RangeMultiplier(10)->Range(1, 100000);
+BENCHMARK(BM_StdFunctionTrigger)->RangeMultiplier(10)->Range(1, 100000);
+BENCHMARK(BM_StdFunctionMemberTrigger)->RangeMultiplier(10)->Range(1, 100000);
+BENCHMARK(BM_LinkedEventRegister)->RangeMultiplier(10)->Range(1, 100000);
+BENCHMARK(BM_LinkedEventTrigger)->ArgsProduct({ { 1, 10, 100, 1000, 10000, 100000 }, { 0, 50, 100 } });
+BENCHMARK(BM_PTRConstructDestroy)->RangeMultiplier(10)->Range(1, 100000);
+BENCHMARK(BM_PTRCopy)->RangeMultiplier(10)->Range(1, 100000);
+BENCHMARK(BM_PTRDestroy)->RangeMultiplier(10)->Range(1, 100000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "../../Runtime/Core/Core.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Syn
+{
+    /***
+     * Bump allocator for event payloads that only live for one frame.
+     * Payloads are constructed once per broadcast and released together by Reset() at frame end.
+    **/
+    class SYN_API EventPayloadArena
+    {
+    private:
+        struct Block
+        {
+            std::unique_ptr<std::byte[]> memory;
+            size_t size;
+        };
+
+        struct DestructorNode
+        {
+            void (*destroy)(void*);
+            void* object;
+            DestructorNode* next;
+        };
+
+        std::vector<Block> blocks;
+        size_t currentBlock = 0;
+        size_t offset = 0;
+        size_t blockSize;
+        DestructorNode* destructors = nullptr;
+
+        void* AllocateFromBlocks(size_t size, size_t alignment)
+        {
+            while (currentBlock < blocks.size())
+            {
+                Block& block = blocks[currentBlock];
+                const auto base = reinterpret_cast<uintptr_t>(block.memory.get());
+                const uintptr_t aligned = (base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+                if (aligned + size <= base + block.size)
+                {
+                    offset = aligned + size - base;
+                    return reinterpret_cast<void*>(aligned);
+                }
+                currentBlock++;
+                offset = 0;
+            }
+
+            const size_t newBlockSize = std::max(blockSize, size + alignment);
+            blocks.push_back({ std::make_unique<std::byte[]>(newBlockSize), newBlockSize });
+            currentBlock = blocks.size() - 1;
+            offset = 0;
+            return AllocateFromBlocks(size, alignment);
+        }
+
+    public:
+        explicit EventPayloadArena(size_t BlockSize = 64 * 1024) : blockSize(BlockSize)
+        {
+        }
+
+        ~EventPayloadArena()
+        {
+            Reset();
+        }
+
+        EventPayloadArena(const EventPayloadArena&) = delete;
+        EventPayloadArena& operator=(const EventPayloadArena&) = delete;
+
+        void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+        {
+            return AllocateFromBlocks(size, alignment);
+        }
+
+        /**
+         * Example Usage : const Payload& payload = arena.Emplace<Payload>(args...);
+         * Reference stays valid until Reset
+         **/
+        template <typename P, typename... Args>
+        P& Emplace(Args&&... args)
+        {
+            void* memory = Allocate(sizeof(P), alignof(P));
+            P* payload = new(memory) P(std::forward<Args>(args)...);
+
+            if constexpr (!std::is_trivially_destructible_v<P>)
+            {
+                void* nodeMemory = Allocate(sizeof(DestructorNode), alignof(DestructorNode));
+                destructors = new(nodeMemory) DestructorNode{
+                    [](void* object) { static_cast<P*>(object)->~P(); }, payload, destructors
+                };
+            }
+
+            return *payload;
+        }
+
+        // Call at frame end. Runs payload destructors in reverse order and keeps the blocks for the next frame
+        void Reset()
+        {
+            while (destructors != nullptr)
+            {
+                DestructorNode* node = destructors;
+                destructors = node->next;
+                node->destroy(node->object);
+            }
+            currentBlock = 0;
+            offset = 0;
+        }
+
+        size_t ReservedBytes() const
+        {
+            size_t total = 0;
+            for (const auto& block : blocks)
+            {
+                total += block.size;
+            }
+            return total;
+        }
+    };
+}
@@ -4,6 +4,8 @@
 #include "../Engine/ObjectGC.h"
 #include "../Core/GameObject.h"
 #include "ObjectGC.h"
+#include "Epoch.h"
+#include <atomic>
 #include <memory>
 
 namespace Syn
@@ -15,7 +17,17 @@ namespace Syn
 }
 
 namespace Syn::Engine {
+	// Validity shared by every copy of a PTR. The object itself is owned here so Destroy
+	// can hand it to the EpochManager while other copies still hold the block.
+	struct PTRControlBlock
+	{
+		std::atomic<bool> isValid{ true };
+		std::shared_ptr<void> owner;
+	};
+
 	// Don't pass by reference
+	// IsValid() and Get() may be called from any thread as long as the caller is inside an EpochGuard
+	// Destroy() on one thread never frees the object under a reader, memory is released after the grace period
 	template<class T>
 	class SYN_API PTR : public IGarbageCollectable {
 		friend class Syn::Core::GameInstance;
@@ -25,8 +37,8 @@ namespace Syn::Engine {
 
 	private:
 
-		std::shared_ptr<T> rawPtr;
-		bool* isValid = nullptr;
+		T* rawPtr = nullptr;
+		std::shared_ptr<PTRControlBlock> control;
 
 	private:
 
@@ -38,54 +50,59 @@ namespace Syn::Engine {
 			free(p);
 		}
 
+		// Used by the conversion operators so they don't allocate a throwaway object
+		struct NoAllocation {};
+
+		explicit PTR(NoAllocation)
+		{
+		}
+
 	public:
 
 		PTR()
 		{
-			if (rawPtr.use_count() == 0)
-			{
-				rawPtr = std::make_shared<T>();
-				isValid = new bool;
-				*isValid = true;
-			}
+			std::shared_ptr<T> object = std::make_shared<T>();
+			rawPtr = object.get();
+			control = std::make_shared<PTRControlBlock>();
+			control->owner = std::move(object);
 		}
 
 		~PTR() {
-			if (rawPtr.use_count() == 2) {
-				*isValid = false;
+			if (control.use_count() == 2) {
+				control->isValid.store(false);
 			}
 		}
 
 		operator PTR<Syn::Core::Object>() const
 		{
-			PTR<Syn::Core::Object> ptr;
+			PTR<Syn::Core::Object> ptr{ typename PTR<Syn::Core::Object>::NoAllocation{} };
 			ptr.rawPtr = rawPtr;
-			ptr.isValid = isValid;
+			ptr.control = control;
 			return ptr;
 		}
 
 		operator PTR<Syn::Core::GameObject>() const
 		{
-			PTR<Syn::Core::GameObject> ptr;
+			PTR<Syn::Core::GameObject> ptr{ typename PTR<Syn::Core::GameObject>::NoAllocation{} };
 			ptr.rawPtr = rawPtr;
-			ptr.isValid = isValid;
+			ptr.control = control;
 			return ptr;
 		}
 
 		T* operator->()
 		{
-			return rawPtr.get();
+			return rawPtr;
 		}
 
 		bool operator == (const PTR<T>& ptr)
 		{
-			if (rawPtr.get() == ptr.rawPtr.get())
+			if (rawPtr == ptr.rawPtr)
 				return true;
 			return false;
 		}
 
 		T& Get() {
-			return *rawPtr.get();
+			return *rawPtr;
 		}
 
 		template<typename ... X>
@@ -93,18 +110,20 @@ namespace Syn::Engine {
 			return std::bind(ref, *rawPtr);
 		}
 
+		// Marks every copy dead right away, the object is released once all readers left their epoch
 		void Destroy() {
-			rawPtr.reset();
-			*isValid = false;
+			if (control && control->isValid.exchange(false)) {
+				EpochManager::Get().Retire(std::move(control->owner));
+			}
 		}
 
 		bool IsValid() {
-			return isValid;
+			return control && control->isValid.load();
 		}
 
 		bool IsCollectable() override
 		{
-			if (rawPtr.use_count() == 1) {
+			if (control.use_count() == 1) {
 				return true;
 			}
 			return false;
@@ -0,0 +1,99 @@
+#include "../PCG/MapChunkPlanner.h"
+
+void FMapChunkStitch::ApplyTo(FMapLayoutRoom& FirstRoom) const
+{
+	if (!IsValid())
+	{
+		return;
+	}
+	FirstRoom.Connection = EMapLayoutConnection::Portal;
+	FirstRoom.ParentPointIndex = ExitPointIndex;
+	FirstRoom.IsParentPointPuzzlePoint = false;
+	FirstRoom.PortalSet = PortalSet;
+	FirstRoom.PortalIndex = PortalIndex;
+}
+
+FMapChunkPlanner::FMapChunkPlanner(const FMapLayoutTemplates& InTemplates, const FMapLayoutSettings& InMapSettings, const FMapChunkSettings& InChunkSettings)
+	: Templates(InTemplates)
+	, MapSettings(InMapSettings)
+	, ChunkSettings(InChunkSettings)
+	, ChunkRandom(FMapRandomStream(InMapSettings.Seed).Split(EMapRandomPurpose::Chunk))
+{
+	ChunkSettings.RoomsPerChunk = FMath::Max(ChunkSettings.RoomsPerChunk, 1);
+}
+
+FVector FMapChunkPlanner::GetChunkOrigin(int32 ChunkIndex) const
+{
+	return MapSettings.StartRoomLocation + ChunkSettings.ChunkStride * ChunkIndex;
+}
+
+int32 FMapChunkPlanner::GetChunkAt(const FVector& Location) const
+{
+	const double StrideSquared = ChunkSettings.ChunkStride.SizeSquared();
+	if (StrideSquared < UE_KINDA_SMALL_NUMBER)
+	{
+		return 0;
+	}
+	return FMath::RoundToInt32(FVector::DotProduct(Location - MapSettings.StartRoomLocation, ChunkSettings.ChunkStride) / StrideSquared);
+}
+
+FMapLayoutSettings FMapChunkPlanner::MakeChunkSettings(int32 ChunkIndex) const
+{
+	FMapLayoutSettings Settings = MapSettings;
+	Settings.Seed = ChunkRandom.Split(static_cast<uint64>(ChunkIndex)).NextUInt32();
+	Settings.BattleRoomCount = ChunkSettings.RoomsPerChunk;
+	/** Endless, the map never reaches a boss */
+	Settings.HasBossRoom = false;
+	Settings.StartsWithBattleRoom = ChunkIndex > 0;
+	Settings.StartRoomLocation = GetChunkOrigin(ChunkIndex);
+	Settings.PortalRoomPlacementOrigin = Settings.StartRoomLocation;
+	return Settings;
+}
+
+FMapLayoutChunk FMapChunkPlanner::SolveChunk(int32 ChunkIndex) const
+{
+	FMapLayoutChunk Chunk;
+	Chunk.ChunkIndex = ChunkIndex;
+	FMapLayoutSolver Solver(Templates, MakeChunkSettings(ChunkIndex));
+	Chunk.Plan = Solver.Solve();
+
+	for (const FMapLayoutRoom& Room : Chunk.Plan.Rooms)
+	{
+		if (GetChunkAt(Room.WorldBounds.Min) != ChunkIndex || GetChunkAt(Room.WorldBounds.Max) != ChunkIndex)
+		{
+			Chunk.RoomsOutsideRegion++;
+		}
+	}
+	return Chunk;
+}
+
+FMapChunkStitch FMapChunkPlanner::MakeStitch(int32 ChunkIndex, const FMapLayoutPlan& PreviousPlan) const
+{
+	FMapChunkStitch Stitch;
+	FMapRandomStream StitchRandom = ChunkRandom.Split(static_cast<uint64>(ChunkIndex)).Split(EMapRandomPurpose::Portal);
+
+	/** Walks back from the last main path room until one still has a free exit */
+	for (int32 RoomIndex = PreviousPlan.Rooms.Num() - 1; RoomIndex >= 0; RoomIndex--)
+	{
+		const FMapLayoutRoom& Room = PreviousPlan.Rooms[RoomIndex];
+		if (Room.IsSideRoom || Room.AvailableExitPoints.IsEmpty())
+		{
+			continue;
+		}
+		Stitch.FromRoom = RoomIndex;
+		Stitch.ExitPointIndex = Room.AvailableExitPoints[StitchRandom.RandRange(0, Room.AvailableExitPoints.Num() - 1)];
+		/** Without battle room portals the stitch uses the start room portal, same as the door fallback of the generator */
+		if (Room.Kind == EMapLayoutRoomKind::Start || Templates.BattleRoomPortalCount <= 0)
+		{
+			Stitch.PortalSet = EMapLayoutPortalSet::StartRoom;
+			Stitch.PortalIndex = 0;
+		}
+		else
+		{
+			Stitch.PortalSet = EMapLayoutPortalSet::Battle;
+			Stitch.PortalIndex = StitchRandom.RandRange(0, Templates.BattleRoomPortalCount - 1);
+		}
+		break;
+	}
+	return Stitch;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MapLayoutSolver.h"
+
+/** Portal from a free exit of the previous chunk's last rooms to the first room of a chunk */
+struct FMapChunkStitch
+{
+	/** Room of the previous chunk's plan the portal leaves from */
+	int32 FromRoom = INDEX_NONE;
+	int32 ExitPointIndex = INDEX_NONE;
+	EMapLayoutPortalSet PortalSet = EMapLayoutPortalSet::Battle;
+	int32 PortalIndex = INDEX_NONE;
+
+	FORCEINLINE bool IsValid() const { return FromRoom != INDEX_NONE; }
+	/** Turns the unconnected first room of a chunk plan into a room behind the stitch portal */
+	void ApplyTo(FMapLayoutRoom& FirstRoom) const;
+};
+
+/** One solved chunk of a chunked map, room ids are local to the chunk */
+struct FMapLayoutChunk
+{
+	int32 ChunkIndex = INDEX_NONE;
+	FMapLayoutPlan Plan;
+	FMapChunkStitch Stitch;
+	/** Rooms that reach into the region of another chunk, the chunk stride is too small for the rooms per chunk */
+	int32 RoomsOutsideRegion = 0;
+};
+
+struct FMapChunkSettings
+{
+	int32 RoomsPerChunk = 24;
+	/** Distance between the start locations of two chunks. Keep it across PortalRoomPlacementOffset, islands of a chunk walk along that */
+	FVector ChunkStride{1000000, -1000000, 0};
+};
+
+/**
+ * Splits an endless map into chunks of a fixed number of rooms that are solved on their own.
+ * A chunk only depends on the map seed and its index: it gets its own seed split off the map seed and its own region along
+ * ChunkStride, so any chunk can be solved on any thread in any order. Only the stitch portal needs the plan of the chunk before.
+ */
+class PVD_API FMapChunkPlanner
+{
+public:
+	FMapChunkPlanner(const FMapLayoutTemplates& InTemplates, const FMapLayoutSettings& InMapSettings, const FMapChunkSettings& InChunkSettings);
+
+	/** Map settings with the seed, size and region of the chunk. Chunk 0 starts with the start room, every other chunk with a battle room */
+	FMapLayoutSettings MakeChunkSettings(int32 ChunkIndex) const;
+	/** Solves the chunk without its stitch, safe to call from worker threads */
+	FMapLayoutChunk SolveChunk(int32 ChunkIndex) const;
+	/** Free exit of the last main path rooms of the previous chunk, drawn from a stream of the chunk that is stitched on */
+	FMapChunkStitch MakeStitch(int32 ChunkIndex, const FMapLayoutPlan& PreviousPlan) const;
+
+	FVector GetChunkOrigin(int32 ChunkIndex) const;
+	/** Chunk whose region contains the location, regions are slabs across ChunkStride centered on the chunk origins */
+	int32 GetChunkAt(const FVector& Location) const;
+
+	FORCEINLINE const FMapChunkSettings& GetChunkSettings() const { return ChunkSettings; }
+
+private:
+	/** Copied, chunks are solved on worker threads long after the generator built the templates */
+	FMapLayoutTemplates Templates;
+	FMapLayoutSettings MapSettings;
+	FMapChunkSettings ChunkSettings;
+	FMapRandomStream ChunkRandom;
+};
@@ -0,0 +1,183 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "../PCG/MapGenerationBenchmarkCommandlet.h"
+
+#include "../PCG/MapLayoutCache.h"
+#include "../PCG/MapSnapshot.h"
+#include "../PCG/RoomTemplateTable.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "PVD/PVD.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace
+{
+	TArray<int32> ParseIntList(const FString& Params, const TCHAR* Name, const TArray<int32>& Default)
+	{
+		TArray<int32> Values;
+		FString List;
+		if (FParse::Value(*Params, Name, List, false))
+		{
+			TArray<FString> Entries;
+			List.ParseIntoArray(Entries, TEXT(","));
+			for (const FString& Entry : Entries)
+			{
+				Values.Add(FCString::Atoi(*Entry));
+			}
+		}
+		return Values.IsEmpty() ? Default : Values;
+	}
+
+	double GetPercentile(TArray<double>& SortedValues, double Percentile)
+	{
+		if (SortedValues.IsEmpty())
+		{
+			return 0;
+		}
+		const int32 Index = FMath::Clamp(FMath::CeilToInt32(Percentile * SortedValues.Num()) - 1, 0, SortedValues.Num() - 1);
+		return SortedValues[Index];
+	}
+}
+
+int32 UMapGenerationBenchmarkCommandlet::Main(const FString& Params)
+{
+	FMapLayoutTemplates Templates;
+	FMapLayoutSettings BaseSettings;
+	if (!LoadLayoutInput(Params, Templates, BaseSettings))
+	{
+		return 1;
+	}
+
+	const TArray<int32> MapSizes = ParseIntList(Params, TEXT("Sizes="), {10, 100, 1000, 10000});
+	const TArray<int32> SafeRoomFrequencies = ParseIntList(Params, TEXT("SafeRoomFrequencies="), {BaseSettings.SafeRoomFrequency});
+	const TArray<int32> PuzzleRoomFrequencies = ParseIntList(Params, TEXT("PuzzleRoomFrequencies="), {BaseSettings.PuzzleRoomFrequency});
+	/** Only the parallel solve uses more than one thread */
+	const TArray<int32> ThreadCounts = BaseSettings.SolveIslandsInParallel ? ParseIntList(Params, TEXT("Threads="), {1}) : TArray<int32>{1};
+	int32 SeedCount = 16;
+	FString Label = TEXT("local");
+	FString OutputPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("MapGenerationBenchmark.json"));
+	FParse::Value(*Params, TEXT("Seeds="), SeedCount);
+	FParse::Value(*Params, TEXT("Label="), Label);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+	SeedCount = FMath::Max(SeedCount, 1);
+
+	TArray<FString> Records;
+	int32 MismatchCount = 0;
+	for (const int32 MapSize : MapSizes)
+	{
+		for (const int32 SafeRoomFrequency : SafeRoomFrequencies)
+		{
+			for (const int32 PuzzleRoomFrequency : PuzzleRoomFrequencies)
+			{
+				FMapLayoutSettings Settings = BaseSettings;
+				Settings.BattleRoomCount = MapSize;
+				Settings.SafeRoomFrequency = FMath::Max(SafeRoomFrequency, 0);
+				Settings.PuzzleRoomFrequency = FMath::Max(PuzzleRoomFrequency, 0);
+
+				/** Serialized plans of the first thread count, per seed */
+				TArray<TArray<uint8>> ReferencePlans;
+				ReferencePlans.SetNum(SeedCount);
+				for (const int32 ThreadCount : ThreadCounts)
+				{
+					TArray<double> Milliseconds;
+					int64 PlacementAttempts = 0;
+					int64 OverlapTests = 0;
+					int64 NearMissQueries = 0;
+					int64 PortalFallbacks = 0;
+					int64 PortalsAvoided = 0;
+					int64 Rooms = 0;
+					double BytesPerRoom = 0;
+					int64 SnapshotBytes = 0;
+					double SnapshotLoadMilliseconds = 0;
+					for (int32 SeedIndex = 0; SeedIndex < SeedCount; SeedIndex++)
+					{
+						Settings.Seed = static_cast<uint32>(SeedIndex);
+						FMapLayoutSolver Solver(Templates, Settings);
+						Solver.SetMaxWorkerCount(ThreadCount);
+						const double StartTime = FPlatformTime::Seconds();
+						FMapLayoutPlan Plan = Solver.Solve();
+						Milliseconds.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+
+						if (Settings.SolveIslandsInParallel)
+						{
+							TArray<uint8> PlanData;
+							FMemoryWriter Ar(PlanData);
+							FMapLayoutCache::SerializePlan(Ar, Plan);
+							if (ReferencePlans[SeedIndex].IsEmpty())
+							{
+								ReferencePlans[SeedIndex] = MoveTemp(PlanData);
+							}
+							else if (PlanData != ReferencePlans[SeedIndex])
+							{
+								MismatchCount++;
+								PVD_LOG(Error, TEXT("Seed %d with %d battle rooms differs between %d and %d threads"), SeedIndex, MapSize, ThreadCounts[0], ThreadCount);
+							}
+						}
+
+						/** Restoring a saved map has to stay well below solving it */
+						TArray<uint8> SnapshotData;
+						if (FMapSnapshot::Save(Plan, TemplateTable->SourceContainer, {}, TBitArray<>(), SnapshotData))
+						{
+							FMapLayoutPlan RestoredPlan;
+							TBitArray<> SpawnedRooms;
+							FString Error;
+							const double LoadStartTime = FPlatformTime::Seconds();
+							if (!FMapSnapshot::Load(SnapshotData, TemplateTable->SourceContainer, {}, TemplateTable, RestoredPlan, SpawnedRooms, Error))
+							{
+								PVD_LOG(Error, TEXT("Snapshot of seed %d with %d battle rooms could not be restored: %s"), SeedIndex, MapSize, *Error);
+							}
+							SnapshotLoadMilliseconds += (FPlatformTime::Seconds() - LoadStartTime) * 1000.0;
+							SnapshotBytes += SnapshotData.Num();
+						}
+
+						PlacementAttempts += Plan.PlacementAttempts;
+						OverlapTests += Plan.OverlapTests;
+						NearMissQueries += Plan.NearMissQueries;
+						PortalFallbacks += Plan.PortalFallbackCount;
+						PortalsAvoided += Plan.AvoidedPortalCount;
+						Rooms += Plan.Rooms.Num();
+						BytesPerRoom += static_cast<double>(Solver.GetAllocatedSize() + Plan.GetAllocatedSize()) / FMath::Max(Plan.Rooms.Num(), 1);
+					}
+
+					Milliseconds.Sort();
+					double TotalMilliseconds = 0;
+					for (const double Value : Milliseconds)
+					{
+						TotalMilliseconds += Value;
+					}
+					const double MeanMilliseconds = TotalMilliseconds / SeedCount;
+
+					Records.Add(FString::Printf(TEXT("{\"label\":\"%s\",\"battleRooms\":%d,\"safeRoomFrequency\":%d,\"puzzleRoomFrequency\":%d,\"seeds\":%d,\"threads\":%d,")
+						TEXT("\"meanMs\":%.4f,\"medianMs\":%.4f,\"p95Ms\":%.4f,\"minMs\":%.4f,\"maxMs\":%.4f,")
+						TEXT("\"rooms\":%.1f,\"placementAttempts\":%.1f,\"overlapTests\":%.1f,\"nearMissQueries\":%.1f,\"portalFallbacks\":%.2f,\"portalsAvoided\":%.2f,\"bytesPerRoom\":%.1f,")
+						TEXT("\"snapshotBytes\":%.1f,\"snapshotLoadMs\":%.4f}"),
+						*Label.ReplaceCharWithEscapedChar(), MapSize, Settings.SafeRoomFrequency, Settings.PuzzleRoomFrequency, SeedCount, ThreadCount,
+						MeanMilliseconds, GetPercentile(Milliseconds, 0.5), GetPercentile(Milliseconds, 0.95), Milliseconds[0], Milliseconds.Last(),
+						static_cast<double>(Rooms) / SeedCount, static_cast<double>(PlacementAttempts) / SeedCount, static_cast<double>(OverlapTests) / SeedCount,
+						static_cast<double>(NearMissQueries) / SeedCount, static_cast<double>(PortalFallbacks) / SeedCount, static_cast<double>(PortalsAvoided) / SeedCount, BytesPerRoom / SeedCount,
+						static_cast<double>(SnapshotBytes) / SeedCount, SnapshotLoadMilliseconds / SeedCount));
+
+					PVD_LOG(Display, TEXT("%6d battle rooms, safe %d, puzzle %d, %d threads : %.3f ms mean, %.3f ms p95, %.2f portal fallbacks"),
+						MapSize, Settings.SafeRoomFrequency, Settings.PuzzleRoomFrequency, ThreadCount, MeanMilliseconds, GetPercentile(Milliseconds, 0.95),
+						static_cast<double>(PortalFallbacks) / SeedCount);
+				}
+			}
+		}
+	}
+
+	const FString Json = TEXT("[\n") + FString::Join(Records, TEXT(",\n")) + TEXT("\n]\n");
+	if (!FFileHelper::SaveStringToFile(Json, *OutputPath))
+	{
+		PVD_LOG(Error, TEXT("Benchmark results could not be written to %s"), *OutputPath);
+		return 1;
+	}
+	PVD_LOG(Display, TEXT("Benchmark results written to %s"), *OutputPath);
+	if (MismatchCount > 0)
+	{
+		PVD_LOG(Error, TEXT("%d plans were not the same for every thread count"), MismatchCount);
+		return 1;
+	}
+	return 0;
+}
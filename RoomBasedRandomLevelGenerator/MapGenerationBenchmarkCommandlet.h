@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MapLayoutCommandlet.h"
+#include "MapGenerationBenchmarkCommandlet.generated.h"
+
+/**
+ * Times the layout phase for a range of map sizes and room frequencies and writes the results as JSON.
+ * Runs on one thread so the timings of different commits compare.
+ * With -ParallelLayout every worker count of -Threads= is timed, and every plan has to match the plan of the first count
+ * byte for byte, otherwise the commandlet fails.
+ * Every plan is also saved as an FMapSnapshot and restored, the snapshot size and restore time are written next to the solve time.
+ * Example Usage : UnrealEditor-Cmd.exe PVD.uproject -run=MapGenerationBenchmark -Container=/Game/PCG/DA_RoomContainer
+ *                 -Sizes=10,100,1000,10000 -SafeRoomFrequencies=0,5 -PuzzleRoomFrequencies=0,3 -Seeds=16
+ *                 -Label=<commit> -Output=Saved/MapGenerationBenchmark.json
+ * Determinism check : -run=MapGenerationBenchmark -Container=... -ParallelLayout -Threads=1,2,8,32
+ */
+UCLASS()
+class PVD_API UMapGenerationBenchmarkCommandlet : public UMapLayoutCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "../PCG/MapGenerationStats.h"
+
+#include "Misc/FileHelper.h"
+
+void FMapGenerationStats::Begin(uint32 InSeed, bool InRecordTraceEvents)
+{
+	*this = FMapGenerationStats();
+	Seed = InSeed;
+	RecordTraceEvents = InRecordTraceEvents;
+	StartSeconds = FPlatformTime::Seconds();
+	Phases.SetNum(static_cast<int32>(EMapGenerationPhase::Count));
+	for (int32 PhaseIndex = 0; PhaseIndex < Phases.Num(); PhaseIndex++)
+	{
+		Phases[PhaseIndex].Phase = static_cast<EMapGenerationPhase>(PhaseIndex);
+	}
+}
+
+void FMapGenerationStats::End()
+{
+	TotalMilliseconds = (FPlatformTime::Seconds() - StartSeconds) * 1000.0;
+}
+
+void FMapGenerationStats::AddSample(EMapGenerationPhase Phase, double SampleStartSeconds, double DurationSeconds)
+{
+	if (!Phases.IsValidIndex(static_cast<int32>(Phase)))
+	{
+		return;
+	}
+	FMapGenerationPhaseStats& PhaseStats = Phases[static_cast<int32>(Phase)];
+	const float Milliseconds = DurationSeconds * 1000.0;
+	PhaseStats.Milliseconds += Milliseconds;
+	PhaseStats.MaxMilliseconds = FMath::Max(PhaseStats.MaxMilliseconds, Milliseconds);
+	PhaseStats.Calls++;
+	if (RecordTraceEvents)
+	{
+		TraceEvents.Add({Phase, SampleStartSeconds - StartSeconds, DurationSeconds});
+	}
+}
+
+FString FMapGenerationStats::ToString() const
+{
+	FString Result = FString::Printf(TEXT("Seed %lld, %d rooms in %.2f ms%s (%d placement attempts, %d overlap tests, %d near misses, %d portal fallbacks, %d avoided)"),
+		Seed, RoomCount, TotalMilliseconds, IsLayoutFromCache ? TEXT(", cached layout") : TEXT(""), PlacementAttempts, OverlapTests, NearMissQueries, PortalFallbacks, PortalsAvoided);
+	Result += FString::Printf(TEXT("\n  %d navmesh volumes, built in %.2f ms"), NavMeshVolumeCount, NavMeshBuildMilliseconds);
+	for (const FMapGenerationPhaseStats& PhaseStats : Phases)
+	{
+		Result += FString::Printf(TEXT("\n  %-16s %9.3f ms %7d calls %8.3f ms max"), *UEnum::GetDisplayValueAsText(PhaseStats.Phase).ToString(),
+			PhaseStats.Milliseconds, PhaseStats.Calls, PhaseStats.MaxMilliseconds);
+	}
+	return Result;
+}
+
+bool FMapGenerationStats::ExportTrace(const FString& FilePath) const
+{
+	TArray<FString> Events;
+	Events.Reserve(TraceEvents.Num());
+	for (const FMapGenerationTraceEvent& Event : TraceEvents)
+	{
+		/** Layout solving runs on a worker in async mode, it gets its own track */
+		const int32 Track = Event.Phase == EMapGenerationPhase::Layout || Event.Phase == EMapGenerationPhase::CollisionQuery ? 1 : 0;
+		Events.Add(FString::Printf(TEXT("{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}"),
+			*UEnum::GetDisplayValueAsText(Event.Phase).ToString(), Track, Event.Start * 1000000.0, Event.Duration * 1000000.0));
+	}
+	const FString Json = FString::Printf(TEXT("{\"traceEvents\":[\n%s\n],\"otherData\":{\"seed\":%lld,\"totalMs\":%.3f}}\n"),
+		*FString::Join(Events, TEXT(",\n")), Seed, TotalMilliseconds);
+	return FFileHelper::SaveStringToFile(Json, *FilePath);
+}
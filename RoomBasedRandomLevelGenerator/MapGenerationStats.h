@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "MapGenerationStats.generated.h"
+
+/** Phases are timed inclusively, CollisionQuery runs inside Layout and SpawnActor/Minimap inside Connection */
+UENUM(BlueprintType)
+enum class EMapGenerationPhase : uint8
+{
+	/** Solving the layout or loading it from the layout cache */
+	Layout,
+	/** Physics checks for rooms close to level geometry */
+	CollisionQuery,
+	SpawnActor,
+	/** Doors and portals between rooms */
+	Connection,
+	NavMesh,
+	Minimap,
+	/** Enemy and entity spawners of the rooms */
+	EntitySpawn,
+	Finish,
+	Count UMETA(Hidden)
+};
+
+USTRUCT(BlueprintType)
+struct FMapGenerationPhaseStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	EMapGenerationPhase Phase = EMapGenerationPhase::Layout;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float Milliseconds = 0.f;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 Calls = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float MaxMilliseconds = 0.f;
+};
+
+struct FMapGenerationTraceEvent
+{
+	EMapGenerationPhase Phase;
+	/** Seconds since the generation started */
+	double Start;
+	double Duration;
+};
+
+/** Timings and counters of one map generation */
+USTRUCT(BlueprintType)
+struct PVD_API FMapGenerationStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int64 Seed = 0;
+	/** Wall time from the start of the generation to the last spawned room, frames in between included */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float TotalMilliseconds = 0.f;
+	/** Indexed by EMapGenerationPhase */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	TArray<FMapGenerationPhaseStats> Phases;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 RoomCount = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 PlacementAttempts = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 OverlapTests = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NearMissQueries = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 PortalFallbacks = 0;
+	/** Rooms that only got a door through the placement search */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 PortalsAvoided = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	bool IsLayoutFromCache = false;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NavMeshVolumeCount = 0;
+	/** Time from the batched bounds update until the navigation system finished building, 0 while it is still running */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float NavMeshBuildMilliseconds = 0.f;
+	/** Every timed scope of the generation, only filled when recording is enabled */
+	TArray<FMapGenerationTraceEvent> TraceEvents;
+	bool RecordTraceEvents = false;
+
+	void Begin(uint32 InSeed, bool InRecordTraceEvents);
+	void End();
+	void AddSample(EMapGenerationPhase Phase, double StartSeconds, double DurationSeconds);
+
+	const FMapGenerationPhaseStats& GetPhase(EMapGenerationPhase Phase) const { return Phases[static_cast<int32>(Phase)]; }
+	FString ToString() const;
+	/** Writes the trace events in the Chrome trace event format, loadable in chrome://tracing or Perfetto */
+	bool ExportTrace(const FString& FilePath) const;
+
+private:
+	double StartSeconds = 0;
+};
+
+/** Adds the time of the scope to a phase of the stats */
+class FScopedMapGenerationPhase
+{
+public:
+	FScopedMapGenerationPhase(FMapGenerationStats& InStats, EMapGenerationPhase InPhase)
+		: Stats(InStats), Phase(InPhase), StartSeconds(FPlatformTime::Seconds())
+	{
+	}
+
+	~FScopedMapGenerationPhase()
+	{
+		Stats.AddSample(Phase, StartSeconds, FPlatformTime::Seconds() - StartSeconds);
+	}
+
+private:
+	FMapGenerationStats& Stats;
+	EMapGenerationPhase Phase;
+	double StartSeconds;
+};
+
+/** Times the scope into the stats and shows it as MapGeneration_<Phase> in Unreal Insights */
+#define MAP_GENERATION_PHASE_SCOPE(Stats, PhaseName) \
+	TRACE_CPUPROFILER_EVENT_SCOPE(MapGeneration_##PhaseName); \
+	FScopedMapGenerationPhase PREPROCESSOR_JOIN(MapGenerationPhaseScope, __LINE__)(Stats, EMapGenerationPhase::PhaseName)
@@ -12,16 +12,28 @@
 #include "../PCG/BossRoom.h"
 #include "../PCG/BattleRoom.h"
 #include "../PCG/PuzzleRoom.h"
+#include "../PCG/MapLayoutCache.h"
+#include "../PCG/MapSnapshot.h"
+#include "../PCG/MinimapAtlas.h"
+#include "../PCG/RoomTemplateTable.h"
 #include "AI/NavigationSystemBase.h"
+#include "Async/Async.h"
 #include "Components/BoxComponent.h"
+#include "Components/BrushComponent.h"
+#include "Engine/Engine.h"
 #include "GameFramework/Character.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/PawnMovementComponent.h"
 #include "Kismet/GameplayStatics.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
 #include "NavMesh/NavMeshBoundsVolume.h"
 #include "PVD/PVD.h"
 #include "PVD/PVDPlayerController.h"
 #include "PVD/UI/MainHUDWidget.h"
 #include "PVD/UI/MinimapWidget.h"
 #include "PVD/PCG/PuzzleRoomConnectionPoint.h"
+#include "WorldCollision.h"
 
 
 class UNavigationSystemV1;
@@ -38,6 +50,13 @@ void AMapGenerator::BeginPlay()
 	Super::BeginPlay();
 }
 
+void AMapGenerator::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	CancelGeneration();
+	DiscardNextMap();
+	Super::EndPlay(EndPlayReason);
+}
+
 int AMapGenerator::CreateSeed() const
 {
 	constexpr float MINIMUM_SEED_NUMBER = 0;
@@ -52,228 +71,378 @@ int AMapGenerator::GetContinuousRandomInRange(unsigned int Min, unsigned int Max
 		PVD_LOG(Error, TEXT("Min Value is Greater Equal Than Max Value!"));
 		return 0;
 	}
-	FMath::SRandInit(EvaluatedSeed);
-	float SeedRandom = FMath::SRand();
-	float EvaluatedRandom = SeedRandom / (1.f / (Max + 1 - Min)) + Min;
-	EvaluatedSeed += 1;
-	return EvaluatedRandom;
+	return GeneratorRandom.RandRange(Min, Max);
+}
+
+namespace
+{
+	/**
+	 * Merges boxes that touch as long as the merged box doesn't cover much more than the boxes it replaces.
+	 * Navigation bounds are axis aligned anyway, so nothing is lost by working on world bounds.
+	 */
+	TArray<FBox> MergeNavBounds(const TArray<FBox>& Bounds, float MaxWaste)
+	{
+		constexpr float NavBoundsGridCellSize = 4000.f;
+		TArray<FBox> Merged;
+		TArray<bool> IsAlive;
+		TArray<int32> Candidates;
+		FRoomSpatialGrid Grid(NavBoundsGridCellSize);
+		for (const FBox& Box : Bounds)
+		{
+			if (!Box.IsValid)
+			{
+				continue;
+			}
+			FBox Current = Box;
+			bool HasMerged = true;
+			while (HasMerged)
+			{
+				HasMerged = false;
+				Grid.Query(Current.ExpandBy(1.f), Candidates);
+				for (const int32 Candidate : Candidates)
+				{
+					if (!IsAlive[Candidate])
+					{
+						continue;
+					}
+					const FBox Union = Current + Merged[Candidate];
+					if (Union.GetVolume() <= (Current.GetVolume() + Merged[Candidate].GetVolume()) * (1.f + MaxWaste))
+					{
+						IsAlive[Candidate] = false;
+						Current = Union;
+						HasMerged = true;
+						break;
+					}
+				}
+			}
+			Grid.Insert(Merged.Add(Current), Current);
+			IsAlive.Add(true);
+		}
+
+		TArray<FBox> Result;
+		for (int32 Index = 0; Index < Merged.Num(); Index++)
+		{
+			if (IsAlive[Index])
+			{
+				Result.Add(Merged[Index]);
+			}
+		}
+		return Result;
+	}
+
+	/** Connection points sorted by name so footprints and spawned rooms agree on point indices */
+	template <class T>
+	TArray<T*> GetOrderedPoints(const AActor* Actor)
+	{
+		TArray<T*> Points;
+		Actor->GetComponents<T>(Points);
+		Points.Sort([](const T& A, const T& B)
+		{
+			return A.GetFName().LexicalLess(B.GetFName());
+		});
+		return Points;
+	}
 }
 
-bool AMapGenerator::IsCollisionBlocked(ARoom* Room , FVector const FinalRootLocation , FRotator const FinalRootRotation)
+bool AMapGenerator::IsCollisionBlocked(const FRoomFootprint& Footprint, const FTransform& RoomTransform) const
 {
-	if (GetWorld()->EncroachingBlockingGeometry(Room, FinalRootLocation, FinalRootRotation))
+	const FVector FinalRootLocation = RoomTransform.GetLocation();
+	const FVector BoxLocation = RoomTransform.TransformPosition(Footprint.LocalBounds.GetCenter());
+	const FCollisionShape BoxShape = FCollisionShape::MakeBox(Footprint.LocalBounds.GetExtent());
+	const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(MapGeneratorRoomOverlap), false, this);
+	if (GetWorld()->OverlapBlockingTestByChannel(BoxLocation, RoomTransform.GetRotation(), ECC_WorldStatic, BoxShape, QueryParams))
 	{
 		// a native component is colliding, that's enough to reject spawning
-		UE_LOG(LogSpawn, Log, TEXT("SpawnActor failed because of collision at the spawn location [%s] for [%s]"), *FinalRootLocation.ToString());
+		UE_LOG(LogSpawn, Log, TEXT("Room placement failed because of collision at the spawn location [%s]"), *FinalRootLocation.ToString());
 		return true;
 	}
 	return false;
 }
 
-void AMapGenerator::PlaceRoom(ARoom* Room, bool ConnectWithPortal , bool ApplyNextRoomPassingConditions)
+URoomTemplateTable* AMapGenerator::GetRoomTemplateTable(const UPCGRoomContainer* RoomContainer)
 {
-#define PortalSpawnOffset 100;
+	if (RoomTemplateTable && RoomTemplateTable->SourceContainer == RoomContainer)
+	{
+		return RoomTemplateTable;
+	}
+	/** No baked table for this container, bake one from the class defaults and keep it for later generations */
+	if (RuntimeRoomTemplateTable == nullptr || RuntimeRoomTemplateTable->SourceContainer != RoomContainer)
+	{
+		RuntimeRoomTemplateTable = NewObject<URoomTemplateTable>(this);
+		RuntimeRoomTemplateTable->SourceContainer = const_cast<UPCGRoomContainer*>(RoomContainer);
+		RuntimeRoomTemplateTable->Rebuild();
+	}
+	return RuntimeRoomTemplateTable;
+}
+
+FMapLayoutTemplates AMapGenerator::BuildLayoutTemplates(const UPCGRoomContainer* RoomContainer)
+{
+	return GetRoomTemplateTable(RoomContainer)->MakeLayoutTemplates(SafeRooms.Num());
+}
+
+FMapLayoutSettings AMapGenerator::MakeLayoutSettings(const FMapGenerationParams& MapGenerationParams) const
+{
+	FMapLayoutSettings Settings;
+	Settings.BattleRoomCount = MapGenerationParams.BattleRoomCount;
+	Settings.SafeRoomFrequency = MapGenerationParams.SafeRoomFrequency;
+	Settings.PuzzleRoomFrequency = MapGenerationParams.PuzzleRoomFrequency;
+	Settings.Seed = MapGenerationParams.Seed;
+	Settings.HasBossRoom = MapGenerationParams.HasBossRoom;
+	Settings.MakeBattleRoomsUnique = MapGenerationParams.MakeBattleRoomsUnique;
+	Settings.MakePuzzleRoomsUnique = MapGenerationParams.MakePuzzleRoomsUnique;
+	Settings.MakeSafeRoomsUnique = MapGenerationParams.MakeSafeRoomsUnique;
+	Settings.PortalRoomPlacementOffset = PortalRoomPlacementOffset;
+	Settings.SolveIslandsInParallel = UseParallelLayout;
+	Settings.SearchDoorPlacement = UseDoorPlacementSearch;
+	Settings.DoorSearchBudget = DoorSearchBudget;
+	for (const AActor* SafeRoom : SafeRooms)
+	{
+		if (IsValid(SafeRoom))
+		{
+			Settings.StaticObstacles.Add(SafeRoom->GetComponentsBoundingBox());
+		}
+	}
+	return Settings;
+}
+
+TSubclassOf<ARoom> AMapGenerator::GetPlannedRoomClass(const UPCGRoomContainer* RoomContainer, const FMapLayoutRoom& PlannedRoom)
+{
+	switch (PlannedRoom.Kind)
+	{
+	case EMapLayoutRoomKind::Start:
+		return RoomContainer->StartRooms[PlannedRoom.TemplateIndex];
+	case EMapLayoutRoomKind::Puzzle:
+		return RoomContainer->PuzzleRooms[PlannedRoom.TemplateIndex];
+	case EMapLayoutRoomKind::Boss:
+		return RoomContainer->BossRooms[PlannedRoom.TemplateIndex];
+	default:
+		return RoomContainer->BattleRooms[PlannedRoom.TemplateIndex];
+	}
+}
 
-	if(IsLastRoomSafeRoom)
+TSubclassOf<APortal> AMapGenerator::GetPlannedPortalClass(const UPCGRoomContainer* RoomContainer, const FMapLayoutRoom& PlannedRoom)
+{
+	/** An index outside the set gets the start room portal, same as the door fallback */
+	auto GetPortal = [RoomContainer, &PlannedRoom](const auto& Portals) -> TSubclassOf<APortal>
+	{
+		return Portals.IsValidIndex(PlannedRoom.PortalIndex) ? TSubclassOf<APortal>(Portals[PlannedRoom.PortalIndex]) : RoomContainer->StartRoomPortal;
+	};
+	switch (PlannedRoom.PortalSet)
 	{
-		ConnectWithPortal = true;
+	case EMapLayoutPortalSet::Puzzle:
+		return GetPortal(RoomContainer->PuzzleRoomPortals);
+	case EMapLayoutPortalSet::SafeRoom:
+		return GetPortal(RoomContainer->SafeRoomPortals);
+	case EMapLayoutPortalSet::StartRoom:
+		return RoomContainer->StartRoomPortal;
+	default:
+		return GetPortal(RoomContainer->BattleRoomPortals);
 	}
-	ARoom* RoomToConnect = Room->LastRoom;
+}
+
+void AMapGenerator::PlaceRoom(ARoom* Room, const FMapLayoutRoom& PlannedRoom, ARoom* RoomToConnect)
+{
 	//if its a starter room
-	if (RoomToConnect == nullptr)
+	if (PlannedRoom.Kind == EMapLayoutRoomKind::Start)
 	{
-		Room->SetActorLocation(FVector(10000, 10000, 10000));
 		StartRoomEntrancePoint = Room->EntrancePoint;
-		if (const auto PlayerController = Cast<APVDPlayerController> (UGameplayStatics::GetPlayerController(GetWorld(), 0)))
+		if (const auto MainHUD = GetMainHUD())
 		{
-			if (const auto MainHUD = PlayerController->GetHUDWidget())
+			MAP_GENERATION_PHASE_SCOPE(GenerationStats, Minimap);
+			if (IsBuildingMinimapAtlas)
 			{
-				MainHUD->MiniMap->SpawnMap(Room , Room->GetMinimapTexture(), Room->GetActorLocation() ,Room->GetActorRotation().Yaw);
-				MainHUD->InfoMap->SpawnMap(Room , Room->GetMinimapTexture(), Room->GetActorLocation(), Room->GetActorRotation().Yaw);
+				AddRoomToMinimapAtlas(Room, PlannedRoom);
 			}
+			else
+			{
+				AddMinimapMarker(MainHUD, { Room, Room->GetActorLocation(), static_cast<float>(Room->GetActorRotation().Yaw), false });
+			}
+			MainHUD->InfoMap->SpawnMap(Room , Room->GetMinimapTexture(), Room->GetActorLocation(), Room->GetActorRotation().Yaw);
 		}
 		return;
 	}
-	//this is for puzzle rooms and normal rooms that collide
-	if(ConnectWithPortal)
-	{
-		PortalRoomPlacementCurrentPosition += PortalRoomPlacementOffset;
-		Room->SetActorLocation(PortalRoomPlacementCurrentPosition);
 
-		URoomConnectionPoint* PointToConnect = nullptr;
-		TSubclassOf<APortal> ExitPortal;
-		int Random;
-		if(Cast<APuzzleRoom>(Room))
-		{
-			PointToConnect = Cast<URoomConnectionPoint>(RoomToConnect->GetRandomPuzzleRoomPoint(this));
-			Random = GetContinuousRandomInRange(0,TestRoomContainer->PuzzleRoomPortals.Num() - 1);
-			ExitPortal = TestRoomContainer->PuzzleRoomPortals[Random];			
-		}
-		if(PointToConnect == nullptr)
+	if (RoomToConnect == nullptr)
+	{
+		/** The parent was not spawned or the first room of a chunk could not be stitched to the chunk before */
+		UE_LOG(LogSpawn, Warning, TEXT("%s has no room to connect to and stays unconnected"), *Room->GetName());
+	}
+	else
+	{
+		MAP_GENERATION_PHASE_SCOPE(GenerationStats, Connection);
+		if (PlannedRoom.Connection == EMapLayoutConnection::Door)
 		{
-			PointToConnect = Cast<URoomConnectionPoint>(RoomToConnect->GetRandomExitPoint(this));
-			Random = GetContinuousRandomInRange(0,TestRoomContainer->BattleRoomPortals.Num() - 1);
-			ExitPortal = TestRoomContainer->BattleRoomPortals[Random];
+			ConnectRoomWithDoor(Room, PlannedRoom, RoomToConnect);
 		}
-		if(IsLastRoomSafeRoom)
+		else if (PlannedRoom.Connection != EMapLayoutConnection::None)
 		{
-			Random = GetContinuousRandomInRange(0,TestRoomContainer->SafeRoomPortals.Num() - 1);
-			ExitPortal = TestRoomContainer->SafeRoomPortals[Random];
+			ConnectRoomWithPortal(Room, PlannedRoom, RoomToConnect);
 		}
-		if(Cast<AStartRoom>(Room->LastRoom))
+	}
+
+	/** set minimap texture and location*/
+	if (IsBuildingMinimapAtlas)
+	{
+		AddRoomToMinimapAtlas(Room, PlannedRoom);
+	}
+	else if (const auto MainHUD = GetMainHUD())
+	{
+		MAP_GENERATION_PHASE_SCOPE(GenerationStats, Minimap);
+		AddMinimapMarker(MainHUD, { Room, Room->GetActorLocation(), static_cast<float>(Room->GetActorRotation().Yaw), false });
+	}
+
+	if(Cast<ABattleRoom>(Room) || Cast<AMainBossRoom>(Room))
+	{
+		if(auto const NavBox = Room->NavMeshContentsBox)
 		{
-			ExitPortal = TestRoomContainer->StartRoomPortal;
+			/** Navigation bounds are updated once for the whole map in UpdateNavigationBounds */
+			PendingNavBounds.Add(NavBox->Bounds.GetBox());
 		}
-		if(PointToConnect == nullptr)
+	}
+}
+
+void AMapGenerator::ConnectRoomWithPortal(ARoom* Room, const FMapLayoutRoom& PlannedRoom, ARoom* RoomToConnect)
+{
+#define PortalSpawnOffset 100;
+
+	const bool IsLastRoomSafeRoom = PlannedRoom.Connection == EMapLayoutConnection::SafeRoomPortal;
+
+	URoomConnectionPoint* PointToConnect = nullptr;
+	if (PlannedRoom.IsParentPointPuzzlePoint)
+	{
+		const auto PuzzlePoints = GetOrderedPoints<UPuzzleRoomConnectionPoint>(RoomToConnect);
+		if (PuzzlePoints.IsValidIndex(PlannedRoom.ParentPointIndex))
 		{
-			return;
+			PointToConnect = PuzzlePoints[PlannedRoom.ParentPointIndex];
+			RoomToConnect->AvailablePuzzlePoints.Remove(PuzzlePoints[PlannedRoom.ParentPointIndex]);
 		}
-		
-		//Set Portal Transformation
-		const FVector ExitPortalSpawnLocation = PointToConnect->GetComponentLocation() - PointToConnect->GetForwardVector() * PortalSpawnOffset;
-		const FRotator ExitPortalSpawnRotator = PointToConnect->GetComponentRotation();
-		APortal* ExitPortalActor = Cast<APortal>(GetWorld()->SpawnActor(ExitPortal,&ExitPortalSpawnLocation,&ExitPortalSpawnRotator));
-		if(IsLastRoomSafeRoom)
+	}
+	else
+	{
+		const auto ExitPoints = GetOrderedPoints<URoomExitPoint>(RoomToConnect);
+		if (ExitPoints.IsValidIndex(PlannedRoom.ParentPointIndex))
 		{
-			if(auto const SafeRoomPortal = Cast<ASafeRoomPortal>(ExitPortalActor))
-			{
-				int RandomIndex = GetContinuousRandomInRange(0, SafeRooms.Num() - 1);
-				SafeRoomPortal->ConnectedSafeRoom = Cast<ASafeRoom>(SafeRooms[RandomIndex]);
-				PointToConnect->SpawnPlaceholderMesh();
-			}
+			PointToConnect = ExitPoints[PlannedRoom.ParentPointIndex];
+			RoomToConnect->AvailableExitPoints.Remove(ExitPoints[PlannedRoom.ParentPointIndex]);
 		}
-		ExitPortalActor->AddActorWorldRotation(FRotator{0,180,0});
-		GeneratedPortals.Add(ExitPortalActor);
-		//Spawn Portal Minimap Entities
-		if (const auto PlayerController = Cast<APVDPlayerController> (UGameplayStatics::GetPlayerController(GetWorld(), 0)))
+	}
+	if (PointToConnect == nullptr)
+	{
+		/** The baked template and the spawned room disagree about their points, any free exit of the parent will do for a portal */
+		for (URoomExitPoint* ExitPoint : RoomToConnect->AvailableExitPoints)
 		{
-			if (const auto MainHUD = PlayerController->GetHUDWidget())
+			if (IsValid(ExitPoint))
 			{
-				MainHUD->MiniMap->SpawnPortal(RoomToConnect , PointToConnect->GetComponentLocation() , ExitPortalActor->GetActorRotation().Yaw);
+				PointToConnect = ExitPoint;
+				break;
 			}
 		}
-		URoomEntrancePoint* EntrancePointToConnect = Room->EntrancePoint;
-		TSubclassOf<APortal> EnterPortal = ExitPortal;
-		APortal* EnterPortalActor = Cast<APortal>(GetWorld()->SpawnActor(EnterPortal));
-		const FVector EnterPortalSpawnLocation = EntrancePointToConnect->GetComponentLocation() + EntrancePointToConnect->GetForwardVector() * PortalSpawnOffset;
-		const FRotator EnterPortalSpawnRotator = EntrancePointToConnect->GetComponentRotation();
-		EnterPortalActor->SetActorLocation(EnterPortalSpawnLocation);
-		EnterPortalActor->SetActorRotation(EnterPortalSpawnRotator);
-		
-		GeneratedPortals.Add(EnterPortalActor);
-		if(auto const PuzzleRoom = Cast<APuzzleRoom>(Room))
-		{
-			PuzzleRoom->PuzzleRoomEntrancePortalRef = EnterPortalActor;		
-		}
-		if(IsLastRoomSafeRoom)
+		if (PointToConnect == nullptr)
 		{
-			ExitPortalActor->TeleportTargetPoint = Cast<ASafeRoomPortal>(ExitPortalActor)->ConnectedSafeRoom->EnterPortal->TeleportExitPoint;
-			EnterPortalActor->Disable();
-			EntrancePointToConnect->SpawnPlaceholderMesh();
-			Cast<ASafeRoomPortal>(ExitPortalActor)->ConnectedSafeRoom->ConnectedPortals.Add(EnterPortalActor);
-			ExitPortalActor->Enable();
-		}
-		else
-		{
-			ExitPortalActor->TeleportTargetPoint = EnterPortalActor->TeleportExitPoint;
-			EnterPortalActor->TeleportTargetPoint = ExitPortalActor->TeleportExitPoint;
-			ExitPortalActor->SetConnectedRoom(RoomToConnect);
-			EnterPortalActor->SetConnectedRoom(Room);
+			UE_LOG(LogSpawn, Error, TEXT("Point %d of %s is not on the spawned room and it has no free exit left, %s stays unconnected"),
+				PlannedRoom.ParentPointIndex, *RoomToConnect->GetName(), *Room->GetName());
+			return;
 		}
+		UE_LOG(LogSpawn, Warning, TEXT("Point %d of %s is not on the spawned room, rebake the room template table. %s is connected to %s instead"),
+			PlannedRoom.ParentPointIndex, *RoomToConnect->GetName(), *Room->GetName(), *PointToConnect->GetName());
+		RoomToConnect->AvailableExitPoints.Remove(Cast<URoomExitPoint>(PointToConnect));
+	}
+	const TSubclassOf<APortal> ExitPortal = GetPlannedPortalClass(ActiveRoomContainer.Get(), PlannedRoom);
+
+	//Set Portal Transformation
+	const FVector ExitPortalSpawnLocation = PointToConnect->GetComponentLocation() - PointToConnect->GetForwardVector() * PortalSpawnOffset;
+	const FRotator ExitPortalSpawnRotator = PointToConnect->GetComponentRotation();
+	APortal* ExitPortalActor = AcquirePooledActor<APortal>(ExitPortal, FTransform(ExitPortalSpawnRotator, ExitPortalSpawnLocation));
+	if (ExitPortalActor == nullptr)
+	{
+		UE_LOG(LogSpawn, Error, TEXT("%s has no portal class to connect it to %s"), *Room->GetName(), *RoomToConnect->GetName());
+		return;
+	}
+	ASafeRoomPortal* SafeRoomPortal = Cast<ASafeRoomPortal>(ExitPortalActor);
+	if(IsLastRoomSafeRoom && SafeRoomPortal && SafeRooms.IsValidIndex(PlannedRoom.SafeRoomIndex))
+	{
+		SafeRoomPortal->ConnectedSafeRoom = Cast<ASafeRoom>(SafeRooms[PlannedRoom.SafeRoomIndex]);
+		ShowPlaceholderMesh(PointToConnect);
+	}
+	ExitPortalActor->AddActorWorldRotation(FRotator{0,180,0});
+	GeneratedPortals.Add(ExitPortalActor);
+	//Spawn Portal Minimap Entities
+	if (IsBuildingMinimapAtlas)
+	{
+		MinimapAtlasBuilder.AddPortal(RoomToConnect, PointToConnect->GetComponentLocation(), ExitPortalActor->GetActorRotation().Yaw);
+	}
+	else if (const auto MainHUD = GetMainHUD())
+	{
+		MAP_GENERATION_PHASE_SCOPE(GenerationStats, Minimap);
+		AddMinimapMarker(MainHUD, { RoomToConnect, PointToConnect->GetComponentLocation(), static_cast<float>(ExitPortalActor->GetActorRotation().Yaw), true });
+	}
+	URoomEntrancePoint* EntrancePointToConnect = Room->EntrancePoint;
+	TSubclassOf<APortal> EnterPortal = ExitPortal;
+	const FVector EnterPortalSpawnLocation = EntrancePointToConnect->GetComponentLocation() + EntrancePointToConnect->GetForwardVector() * PortalSpawnOffset;
+	const FRotator EnterPortalSpawnRotator = EntrancePointToConnect->GetComponentRotation();
+	APortal* EnterPortalActor = AcquirePooledActor<APortal>(EnterPortal, FTransform(EnterPortalSpawnRotator, EnterPortalSpawnLocation));
+	
+	GeneratedPortals.Add(EnterPortalActor);
+	if(auto const PuzzleRoom = Cast<APuzzleRoom>(Room))
+	{
+		PuzzleRoom->PuzzleRoomEntrancePortalRef = EnterPortalActor;		
+	}
+	if(IsLastRoomSafeRoom && SafeRoomPortal && SafeRooms.IsValidIndex(PlannedRoom.SafeRoomIndex))
+	{
+		ExitPortalActor->TeleportTargetPoint = SafeRoomPortal->ConnectedSafeRoom->EnterPortal->TeleportExitPoint;
+		EnterPortalActor->Disable();
+		ShowPlaceholderMesh(EntrancePointToConnect);
+		SafeRoomPortal->ConnectedSafeRoom->ConnectedPortals.Add(EnterPortalActor);
+		ExitPortalActor->Enable();
 	}
-	//This is the usual room spawn point
 	else
 	{
-		URoomExitPoint* ExitPointToConnect = RoomToConnect->GetRandomAvailableExitPoint(this ,StartRoomEntrancePoint->GetComponentRotation());
-		//Rotation
-		if(ExitPointToConnect != nullptr)
-		{
-			FRotator ExitPointRotation = ExitPointToConnect->GetComponentRotation();
-			FRotator EnterPointRotation = Room->EntrancePoint->GetComponentRotation();
-			
-			FQuat QuatBetweenExitAndEnter = FQuat::FindBetweenNormals(ExitPointRotation.Vector(), EnterPointRotation.Vector());
-			float Angle = 0;
-			FVector Axis;
-		
-			QuatBetweenExitAndEnter.ToAxisAndAngle(Axis, Angle);
-		
-			Angle = FMath::RadiansToDegrees(Angle);
-			
-			FRotator RoomRotation = Room->GetActorRotation();
-		
-			RoomRotation.Yaw -= Angle * Axis.Z;
-			Room->SetActorRotation(RoomRotation);
-			
-			FVector OffsetBetweenEnterAndExit = ExitPointToConnect->GetComponentLocation() - Room->EntrancePoint->
-			GetComponentLocation();
-
-			if (const auto PlayerController = Cast<APVDPlayerController> (UGameplayStatics::GetPlayerController(GetWorld(), 0)))
-			{
-				if (const auto MainHUD = PlayerController->GetHUDWidget())
-				{
-					MainHUD->MiniMap->SpawnPortal(RoomToConnect ,ExitPointToConnect->GetComponentLocation(), ExitPointRotation.Yaw);
-				}
-			}
-			//Location
-			Room->SetActorLocation(Room->GetActorLocation() + OffsetBetweenEnterAndExit);
-
-			
-			if(IsCollisionBlocked(Room , Room->GetActorLocation(), Room->GetActorRotation()))
-			{
-				RoomToConnect->AvailableExitPoints.Add(ExitPointToConnect);
-				PlaceRoom(Room , true , true);
-				return;
-			}
-			
-			//Placeholder Meshes
-			ExitPointToConnect->SetActivationOfPlaceholderMeshes(false);
-			FVector const DoorSpawnLocation = Room->EntrancePoint->GetComponentLocation();
-			FRotator const DoorSpawnRotation = Room->EntrancePoint->GetComponentRotation();
-			if(auto const StartRoom = Cast<AStartRoom>(Room->LastRoom))
-			{
-				if(ADoor* SpawnedDoor = Cast<ADoor>(GetWorld()->SpawnActor(TestRoomContainer->StartRoomPassageWay, &DoorSpawnLocation , &DoorSpawnRotation)))
-				{
-					SpawnedDoor->SetConnectedRoom(RoomToConnect);
-					GeneratedDoors.Add(SpawnedDoor);
-				}
-			}
-			else
-			{
-				if(ADoor* SpawnedDoor = Cast<ADoor>(GetWorld()->SpawnActor(TestRoomContainer->PassageWays, &DoorSpawnLocation , &DoorSpawnRotation)))
-				{
-					SpawnedDoor->SetConnectedRoom(RoomToConnect);
-					GeneratedDoors.Add(SpawnedDoor);
-				}
-			}
-		}
+		ExitPortalActor->TeleportTargetPoint = EnterPortalActor->TeleportExitPoint;
+		EnterPortalActor->TeleportTargetPoint = ExitPortalActor->TeleportExitPoint;
+		ExitPortalActor->SetConnectedRoom(RoomToConnect);
+		EnterPortalActor->SetConnectedRoom(Room);
 	}
+}
 
-	/** set minimap texture and location*/
-	if (const auto PlayerController = Cast<APVDPlayerController> (UGameplayStatics::GetPlayerController(GetWorld(), 0)))
+//This is the usual room spawn point, the room is already aligned to the exit by the layout solver
+void AMapGenerator::ConnectRoomWithDoor(ARoom* Room, const FMapLayoutRoom& PlannedRoom, ARoom* RoomToConnect)
+{
+	const auto ExitPoints = GetOrderedPoints<URoomExitPoint>(RoomToConnect);
+	if (!ExitPoints.IsValidIndex(PlannedRoom.ParentPointIndex))
 	{
-		if (const auto MainHUD = PlayerController->GetHUDWidget())
-		{
-			MainHUD->MiniMap->SpawnMap(Room, Room->GetMinimapTexture(), Room->GetActorLocation() ,Room->GetActorRotation().Yaw);
-		}
+		/** Points added at runtime or in the construction script are missing from the baked template, a portal still connects the rooms */
+		UE_LOG(LogSpawn, Warning, TEXT("Exit point %d of %s is not on the spawned room, %s is connected with a portal instead of a door"),
+			PlannedRoom.ParentPointIndex, *RoomToConnect->GetName(), *Room->GetName());
+		FMapLayoutRoom PortalRoom = PlannedRoom;
+		PortalRoom.Connection = EMapLayoutConnection::Portal;
+		PortalRoom.IsParentPointPuzzlePoint = false;
+		PortalRoom.PortalSet = ActiveRoomContainer->BattleRoomPortals.IsEmpty() ? EMapLayoutPortalSet::StartRoom : EMapLayoutPortalSet::Battle;
+		PortalRoom.PortalIndex = 0;
+		ConnectRoomWithPortal(Room, PortalRoom, RoomToConnect);
+		return;
 	}
+	URoomExitPoint* ExitPointToConnect = ExitPoints[PlannedRoom.ParentPointIndex];
+	RoomToConnect->AvailableExitPoints.Remove(ExitPointToConnect);
 
-	if(Cast<ABattleRoom>(Room) || Cast<AMainBossRoom>(Room))
+	if (IsBuildingMinimapAtlas)
 	{
-		if(auto const NavBox = Room->NavMeshContentsBox)
-		{
-			if (ANavMeshBoundsVolume* NewNavVolume = NavMeshBoundsVolumePool[CurrentNavmeshPoolIndex])
-			{
-				CurrentNavmeshPoolIndex++;
+		MinimapAtlasBuilder.AddPortal(RoomToConnect, ExitPointToConnect->GetComponentLocation(), ExitPointToConnect->GetComponentRotation().Yaw);
+	}
+	else if (const auto MainHUD = GetMainHUD())
+	{
+		MAP_GENERATION_PHASE_SCOPE(GenerationStats, Minimap);
+		AddMinimapMarker(MainHUD, { RoomToConnect, ExitPointToConnect->GetComponentLocation(), static_cast<float>(ExitPointToConnect->GetComponentRotation().Yaw), true });
+	}
 
-				NewNavVolume->SetActorTransform(NavBox->GetComponentTransform());
-				
-				if (UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld()))
-				{
-					NavSystem->OnNavigationBoundsUpdated(NewNavVolume);
-					DrawDebugBox(GetWorld(),NavBox->GetComponentLocation() , NavBox->GetScaledBoxExtent(), FColor::Green, false, 500, 0, 5.0f);
-				}
-			}
-		}
+	//Placeholder Meshes
+	ExitPointToConnect->SetActivationOfPlaceholderMeshes(false);
+	FVector const DoorSpawnLocation = Room->EntrancePoint->GetComponentLocation();
+	FRotator const DoorSpawnRotation = Room->EntrancePoint->GetComponentRotation();
+	const TSubclassOf<AActor> DoorClass = Cast<AStartRoom>(RoomToConnect) ? ActiveRoomContainer->StartRoomPassageWay : ActiveRoomContainer->PassageWays;
+	if(ADoor* SpawnedDoor = Cast<ADoor>(AcquirePooledActor(DoorClass, FTransform(DoorSpawnRotation, DoorSpawnLocation))))
+	{
+		SpawnedDoor->SetConnectedRoom(RoomToConnect);
+		GeneratedDoors.Add(SpawnedDoor);
 	}
 }
 
@@ -285,24 +454,109 @@ void AMapGenerator::PlacePlaceholderMeshesOnEntrances()
 		{
 			for (const auto Element : GeneratedBattleRoom->AvailableExitPoints)
 			{
-				Element->SpawnPlaceholderMesh();
+				ShowPlaceholderMesh(Element);
 			}
 		}
 	}
 }
 
+void AMapGenerator::ShowPlaceholderMesh(URoomConnectionPoint* Point)
+{
+	bool IsAlreadySpawned = false;
+	PointsWithPlaceholder.Add(Point, &IsAlreadySpawned);
+	if (IsAlreadySpawned)
+	{
+		Point->SetActivationOfPlaceholderMeshes(true);
+	}
+	else
+	{
+		Point->SpawnPlaceholderMesh();
+	}
+}
+
 void AMapGenerator::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+
+	if (IsGenerationInProgress)
+	{
+		TickInstantiation();
+	}
+	if (IsWaitingForNavMeshBuild)
+	{
+		TickNavMeshBuild();
+	}
+	if (DeferredSpawnCount > 0)
+	{
+		DeferredSpawnCheckTimer -= DeltaTime;
+		if (DeferredSpawnCheckTimer <= 0.f)
+		{
+			DeferredSpawnCheckTimer = DeferredSpawnCheckInterval;
+			TickDeferredEntitySpawns();
+		}
+	}
+	if (!PendingDestroyActors.IsEmpty())
+	{
+		TickTeardown();
+	}
+	if (IsRoomDormancyActive)
+	{
+		RoomDormancyCheckTimer -= DeltaTime;
+		if (RoomDormancyCheckTimer <= 0.f)
+		{
+			RoomDormancyCheckTimer = RoomDormancyCheckInterval;
+			TickRoomDormancy();
+		}
+	}
+	if (PendingNextLayout.IsValid() && PendingNextLayout.IsReady())
+	{
+		TakeNextLayout();
+	}
+	if (PrespawnNextMap && !PendingNextLayout.IsValid() && NextMapRooms.Num() < NextMapPlan.Rooms.Num())
+	{
+		TickNextMapPrespawn();
+	}
+	if (IsChunkedMapActive)
+	{
+		TickChunkInstantiation();
+		ChunkCheckTimer -= DeltaTime;
+		if (ChunkCheckTimer <= 0.f)
+		{
+			ChunkCheckTimer = ChunkCheckInterval;
+			UpdateChunkWindow();
+		}
+	}
 }
 
-void AMapGenerator::StartGeneration()
+FMapGenerationParams AMapGenerator::MakeTestGenerationParams() const
 {
 	FMapGenerationParams Params = FMapGenerationParams(TestRoomContainer->MapSize, TestRoomContainer->SafeRoomFreq, TestRoomContainer->PuzzleRoomFreq, CreateSeed());
 	Params.HasBossRoom = TestRoomContainer->HasBossRoom;
 	Params.MakeBattleRoomsUnique = TestRoomContainer->MakeBattleRoomsUnique;
 	Params.MakePuzzleRoomsUnique = TestRoomContainer->MakePuzzleRoomsUnique;
 	Params.MakeSafeRoomsUnique = TestRoomContainer->MakeSafeRoomsUnique;
+	return Params;
+}
+
+void AMapGenerator::StartGeneration()
+{
+	const FMapGenerationParams Params = MakeTestGenerationParams();
+	if (UseChunkedGeneration)
+	{
+		StartChunkedGeneration(TestRoomContainer, Params);
+		MapGenerationCompletedHandler.Broadcast();
+		return;
+	}
+	/** A map prepared during the last run only has to be moved into place */
+	if (HasNextMap() && NextMapRoomContainer.Get() == TestRoomContainer && SwapToNextMap())
+	{
+		return;
+	}
+	if (UseAsyncGeneration)
+	{
+		StartAsyncGeneration(TestRoomContainer, Params);
+		return;
+	}
 	GenerateMap(Cast<UPCGRoomContainer>(TestRoomContainer), Params);
 
 	MapGenerationCompletedHandler.Broadcast();
@@ -317,185 +571,1402 @@ void AMapGenerator::GenerateMap(const UPCGRoomContainer* const RoomContainer,con
 	}
 
 	InitialSeed = MapGenerationParams.Seed;
-	EvaluatedSeed = InitialSeed;
-	
-	TArray<TSubclassOf<ABattleRoom>> BattleRooms = RoomContainer->BattleRooms;
-	TArray<TSubclassOf<ABossRoom>> BossRooms = RoomContainer->BossRooms;
-	TArray<TSubclassOf<APuzzleRoom>> PuzzleRooms = RoomContainer->PuzzleRooms;
-	TArray<TSubclassOf<AStartRoom>> StartRooms = RoomContainer->StartRooms;
+	GeneratorRandom = FMapRandomStream(InitialSeed).Split(EMapRandomPurpose::Generator);
+	GenerationStats.Begin(InitialSeed, RecordGenerationTrace);
 
-	const bool HasSafeRoom = MapGenerationParams.SafeRoomFrequency > 0;
-	const bool HasPuzzleRoom = MapGenerationParams.PuzzleRoomFrequency > 0;
-	const bool HasBossRoom = MapGenerationParams.HasBossRoom;
+	FMapLayoutPlan Plan;
+	{
+		MAP_GENERATION_PHASE_SCOPE(GenerationStats, Layout);
+		Plan = SolveLayout(RoomContainer, MapGenerationParams);
+	}
+	if (Plan.IsEmpty())
+	{
+		PVD_LOG(Error, TEXT("Map layout could not be solved for seed %u"), MapGenerationParams.Seed);
+		GenerationStats.End();
+		MapGenerationFailedHandler.Broadcast(static_cast<int32>(MapGenerationParams.Seed));
+		return;
+	}
+	InstantiateLayout(RoomContainer, Plan);
+}
 
-	int LinearRoomCount = MapGenerationParams.BattleRoomCount;
+FMapLayoutPlan AMapGenerator::SolveLayout(const UPCGRoomContainer* const RoomContainer, const FMapGenerationParams& MapGenerationParams)
+{
+	const FMapLayoutTemplates Templates = BuildLayoutTemplates(RoomContainer);
+	const FMapLayoutSettings Settings = MakeLayoutSettings(MapGenerationParams);
+	const FMapLayoutCache LayoutCache(GetLayoutCacheDirectory());
+	const FString CacheKey = MakeLayoutCacheKey(RoomContainer, Templates, Settings, Settings.SolveIslandsInParallel);
+	FMapLayoutPlan Plan;
+	if (UseLayoutCache && LayoutCache.Load(CacheKey, Templates, Plan))
+	{
+		Plan.IsFromCache = true;
+		UE_LOG(LogSpawn, Log, TEXT("Map layout for seed %u loaded from cache"), Settings.Seed);
+		return Plan;
+	}
 
-	if (HasSafeRoom)
+	FMapLayoutSolver Solver(Templates, Settings);
+	Solver.SetNearMissQuery([this](const FRoomFootprint& Footprint, const FTransform& RoomTransform)
 	{
-		LinearRoomCount += MapGenerationParams.BattleRoomCount / MapGenerationParams.SafeRoomFrequency;
+		MAP_GENERATION_PHASE_SCOPE(GenerationStats, CollisionQuery);
+		return IsCollisionBlocked(Footprint, RoomTransform);
+	});
+	Plan = Solver.Solve();
+	if (UseLayoutCache && !Plan.IsEmpty())
+	{
+		LayoutCache.Save(CacheKey, Plan);
 	}
+	return Plan;
+}
 
-	ARoom* LastRoom = nullptr;
-	ARoom* StartRoomRef = nullptr;
-	int SpawnedBattleRoomCount = 0;
-	bool SpawnedPuzzleRoom = false;
-	IsLastRoomSafeRoom = false;
+FString AMapGenerator::GetLayoutCacheDirectory()
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("MapLayoutCache"));
+}
 
-	for (int Index = 0; Index <= LinearRoomCount; Index++)
+FString AMapGenerator::MakeLayoutCacheKey(const UPCGRoomContainer* RoomContainer, const FMapLayoutTemplates& Templates, const FMapLayoutSettings& Settings, bool NearMissesBlocked) const
+{
+	/** Plans hold indices into the container arrays and depend on the level geometry of near misses */
+	FString Salt = GetNameSafe(GetWorld() ? GetWorld()->GetOutermost() : nullptr);
+	Salt += NearMissesBlocked ? TEXT("|Blocked") : TEXT("|Physics");
+	auto AddRoomClasses = [&Salt](const auto& RoomClasses)
 	{
-		if(Index == 0)
+		for (const auto& RoomClass : RoomClasses)
 		{
-			TSubclassOf<AStartRoom> BPStartRoom = PickRandomRoom<AStartRoom>(StartRooms, MapGenerationParams.MakeSafeRoomsUnique);
-			
-			AStartRoom* StartRoom = Cast<AStartRoom>(GetWorld()->SpawnActor(BPStartRoom));
-			PlaceRoom(StartRoom);
-			LastRoom = StartRoom;
-			StartRoomRef = StartRoom;
-			GeneratedStartRoom = StartRoom;
-			StartRoom->SafeRoomEntitySpawner->SpawnEntities();
-			if(LinearRoomCount == 0)
-			{
-				if (Index == LinearRoomCount)
-				{
-					ABossRoom* BossRoom = nullptr;
-					while(BossRoom == nullptr)
-					{
-						TSubclassOf<ABossRoom> BPBossRoom = PickRandomRoom<ABossRoom>(BossRooms);
-						BossRoom = Cast<ABossRoom>(GetWorld()->SpawnActor(BPBossRoom));
-					}
-					if (LastRoom != nullptr)
-					{
-						if (BossRoom != nullptr)
-						{
-							LastRoom->NextRoom = BossRoom;
-							BossRoom->LastRoom = LastRoom;
-							GeneratedBossRooms = BossRoom;
-							LastRoom = BossRoom;
-						}
-					}
-					else
-					{
-						GeneratedBossRooms = BossRoom;
-						LastRoom = BossRoom;
-					}
-				
-					PlaceRoom(BossRoom);
-					BossRoom->SetUpPrepRoom();
-				}
-			}
-			continue;
+			Salt += TEXT("|") + GetPathNameSafe(RoomClass.Get());
 		}
-		
-		if (HasSafeRoom && Index > 0 && !IsLastRoomSafeRoom && SpawnedBattleRoomCount % MapGenerationParams.SafeRoomFrequency == 0 && SpawnedBattleRoomCount != 0)
+	};
+	AddRoomClasses(RoomContainer->StartRooms);
+	AddRoomClasses(RoomContainer->BattleRooms);
+	AddRoomClasses(RoomContainer->PuzzleRooms);
+	AddRoomClasses(RoomContainer->BossRooms);
+	return FMapLayoutCache::MakeKey(Settings, Templates, Salt);
+}
+
+void AMapGenerator::InstantiateLayout(const UPCGRoomContainer* const RoomContainer, const FMapLayoutPlan& Plan)
+{
+	BeginInstantiation(RoomContainer, CopyTemp(Plan));
+	while (NextPlannedRoomIndex < ActivePlan.Rooms.Num())
+	{
+		InstantiatePlannedRoom(NextPlannedRoomIndex++);
+	}
+	FinishInstantiation();
+}
+
+void AMapGenerator::StartAsyncGeneration(const UPCGRoomContainer* const RoomContainer, const FMapGenerationParams& MapGenerationParams)
+{
+	if (RoomContainer == nullptr)
+	{
+		return;
+	}
+	if (IsGenerationInProgress)
+	{
+		PVD_LOG(Warning, TEXT("Map generation is already in progress!"));
+		return;
+	}
+
+	IsGenerationInProgress = true;
+	CurrentNavmeshPoolIndex = 0;
+	InitialSeed = MapGenerationParams.Seed;
+	GeneratorRandom = FMapRandomStream(InitialSeed).Split(EMapRandomPurpose::Generator);
+	GenerationStats.Begin(InitialSeed, RecordGenerationTrace);
+	ActiveRoomContainer = RoomContainer;
+	MapGenerationProgressHandler.Broadcast(0.f);
+	PendingLayout = LaunchLayoutSolve(RoomContainer, MapGenerationParams);
+}
+
+TFuture<FMapLayoutPlan> AMapGenerator::LaunchLayoutSolve(const UPCGRoomContainer* RoomContainer, const FMapGenerationParams& MapGenerationParams)
+{
+	/** Template tables are UObjects, only the solving and the cache files are handled on the worker.
+	 *  Physics can't be queried from there, so near misses with level geometry are treated as blocked */
+	TSharedRef<const FMapLayoutTemplates> Templates = MakeShared<const FMapLayoutTemplates>(BuildLayoutTemplates(RoomContainer));
+	const FMapLayoutSettings Settings = MakeLayoutSettings(MapGenerationParams);
+	const FString CacheKey = UseLayoutCache ? MakeLayoutCacheKey(RoomContainer, *Templates, Settings, true) : FString();
+	return Async(EAsyncExecution::ThreadPool, [Templates, Settings, CacheKey]()
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(MapGeneration_Layout);
+		const double StartSeconds = FPlatformTime::Seconds();
+		const FMapLayoutCache LayoutCache(GetLayoutCacheDirectory());
+		FMapLayoutPlan Plan;
+		if (!CacheKey.IsEmpty() && LayoutCache.Load(CacheKey, *Templates, Plan))
 		{
-            IsLastRoomSafeRoom = true;
+			Plan.IsFromCache = true;
 		}
 		else
 		{
-			TSubclassOf<ABattleRoom> BPBattleRoom = PickRandomRoom<ABattleRoom>(
-				BattleRooms, MapGenerationParams.MakeBattleRoomsUnique);
-			ABattleRoom* BattleRoom = Cast<ABattleRoom>(GetWorld()->SpawnActor(BPBattleRoom));
-			
-			SpawnedBattleRoomCount++;
-
-			if (LastRoom != nullptr)
-			{
-				if (BattleRoom != nullptr)
-				{
-					LastRoom->NextRoom = BattleRoom;
-					BattleRoom->LastRoom = LastRoom;
-					GeneratedBattleRooms.Add(BattleRoom);
-					LastRoom = BattleRoom;
-				}
-			}
-			else
+			FMapLayoutSolver Solver(*Templates, Settings);
+			Plan = Solver.Solve();
+			if (!CacheKey.IsEmpty() && !Plan.IsEmpty())
 			{
-				GeneratedBattleRooms.Add(BattleRoom);
-				LastRoom = BattleRoom;
+				LayoutCache.Save(CacheKey, Plan);
 			}
-			PlaceRoom(BattleRoom);
-			BattleRoom->EnemySpawner->SpawnEnemies();
-			IsLastRoomSafeRoom = false;
+		}
+		Plan.SolveStartSeconds = StartSeconds;
+		Plan.SolveSeconds = FPlatformTime::Seconds() - StartSeconds;
+		return Plan;
+	});
+}
 
-			if(HasPuzzleRoom)
-			{
-				if(MapGenerationParams.PuzzleRoomFrequency != 0 && GeneratedBattleRooms.Num() % MapGenerationParams.PuzzleRoomFrequency == 0)
-				{
-					SpawnedPuzzleRoom = false;
-				}
-				//Try to spawn a puzzle room if it has not spawned in frequency
-				if(!SpawnedPuzzleRoom)
+float AMapGenerator::GetGenerationProgress() const
+{
+	if (!IsGenerationInProgress)
+	{
+		return 1.f;
+	}
+	if (PendingLayout.IsValid() || ActivePlan.IsEmpty())
+	{
+		return 0.f;
+	}
+	return static_cast<float>(NextPlannedRoomIndex) / ActivePlan.Rooms.Num();
+}
+
+void AMapGenerator::BeginInstantiation(const UPCGRoomContainer* const RoomContainer, FMapLayoutPlan&& Plan)
+{
+	EndRoomDormancy();
+	ActiveRoomContainer = RoomContainer;
+	ActivePlan = MoveTemp(Plan);
+	SpawnedPlanRooms.Reset(ActivePlan.Rooms.Num());
+	PendingNavBounds.Reset();
+
+	DeferredSpawnRooms.Init(nullptr, ActivePlan.Rooms.Num());
+	DeferredSpawnCount = 0;
+	PlannedRoomGrid.Reset(FMapLayoutSettings().SpatialGridCellSize);
+	RoomGraph.Build(ActivePlan);
+	PlannedRoomIndices.Reset();
+
+	/** Door connected rooms share a minimap island, parents always come before their children */
+	const UMainHUDWidget* MainHUD = GetMainHUD();
+	IsBuildingMinimapAtlas = UseMinimapAtlas && MainHUD && MainHUD->MiniMap && MainHUD->MiniMap->Implements<UMinimapAtlasReceiver>();
+	MinimapAtlasBuilder.Reset();
+	MinimapIslands.SetNumUninitialized(ActivePlan.Rooms.Num());
+	int32 IslandCount = 0;
+	for (int32 RoomIndex = 0; RoomIndex < ActivePlan.Rooms.Num(); RoomIndex++)
+	{
+		const FMapLayoutRoom& PlannedRoom = ActivePlan.Rooms[RoomIndex];
+		const bool IsDoorConnected = PlannedRoom.Connection == EMapLayoutConnection::Door && ActivePlan.Rooms.IsValidIndex(PlannedRoom.ParentIndex);
+		MinimapIslands[RoomIndex] = IsDoorConnected ? MinimapIslands[PlannedRoom.ParentIndex] : IslandCount++;
+	}
+	NextPlannedRoomIndex = 0;
+}
+
+void AMapGenerator::InstantiatePlannedRoom(int32 PlannedRoomIndex)
+{
+	const FMapLayoutRoom& PlannedRoom = ActivePlan.Rooms[PlannedRoomIndex];
+
+	ARoom* Room = AcquirePlannedRoom(PlannedRoomIndex);
+	SpawnedPlanRooms.Add(Room);
+	if (Room == nullptr)
+	{
+		return;
+	}
+	PlannedRoomIndices.Add(Room, PlannedRoomIndex);
+	PlannedRoomGrid.Insert(PlannedRoomIndex, PlannedRoom.WorldBounds);
+
+	ARoom* LastRoom = SpawnedPlanRooms.IsValidIndex(PlannedRoom.ParentIndex) ? SpawnedPlanRooms[PlannedRoom.ParentIndex] : nullptr;
+	SetUpSpawnedRoom(Room, PlannedRoom, LastRoom, PlannedRoomIndex);
+}
+
+void AMapGenerator::SetUpSpawnedRoom(ARoom* Room, const FMapLayoutRoom& PlannedRoom, ARoom* LastRoom, int32 PlannedRoomIndex)
+{
+	if (LastRoom != nullptr)
+	{
+		Room->LastRoom = LastRoom;
+		if (PlannedRoom.IsSideRoom)
+		{
+			LastRoom->SideRooms.Add(Room);
+		}
+		else
+		{
+			LastRoom->NextRoom = Room;
+		}
+	}
+
+	PlaceRoom(Room, PlannedRoom, LastRoom);
+
+	MAP_GENERATION_PHASE_SCOPE(GenerationStats, EntitySpawn);
+	switch (PlannedRoom.Kind)
+	{
+	case EMapLayoutRoomKind::Start:
+		if (auto const StartRoom = Cast<AStartRoom>(Room))
+		{
+			/** The player starts here, never deferred */
+			GeneratedStartRoom = StartRoom;
+			SpawnRoomEntities(StartRoom);
+		}
+		break;
+	case EMapLayoutRoomKind::Battle:
+		if (auto const BattleRoom = Cast<ABattleRoom>(Room))
+		{
+			GeneratedBattleRooms.Add(BattleRoom);
+			if (!DeferEntitySpawn(PlannedRoomIndex, BattleRoom))
+			{
+				SpawnRoomEntities(BattleRoom);
+			}
+		}
+		break;
+	case EMapLayoutRoomKind::Puzzle:
+		if (auto const PuzzleRoom = Cast<APuzzleRoom>(Room))
+		{
+			GeneratedPuzzleRooms.Add(PuzzleRoom);
+			if (!DeferEntitySpawn(PlannedRoomIndex, PuzzleRoom))
+			{
+				SpawnRoomEntities(PuzzleRoom);
+			}
+		}
+		break;
+	case EMapLayoutRoomKind::Boss:
+		if (auto const BossRoom = Cast<ABossRoom>(Room))
+		{
+			GeneratedBossRooms = BossRoom;
+			BossRoom->SetUpPrepRoom();
+		}
+		break;
+	}
+}
+
+void AMapGenerator::FinishInstantiation()
+{
+	{
+		MAP_GENERATION_PHASE_SCOPE(GenerationStats, Finish);
+		if(IsValid(GeneratedStartRoom))
+		{
+			GeneratedStartRoom->HandleMinimap();
+		}
+		PlacePlaceholderMeshesOnEntrances();
+	}
+	if (IsBuildingMinimapAtlas)
+	{
+		BuildMinimapAtlas();
+	}
+	UpdateNavigationBounds();
+	ReleaseStagedPlanRooms();
+	/** Spawned rooms are kept for room dormancy until the map is destroyed */
+	if (UseRoomDormancy)
+	{
+		BeginRoomDormancy();
+	}
+
+	GenerationStats.RoomCount = ActivePlan.Rooms.Num();
+	GenerationStats.PlacementAttempts = ActivePlan.PlacementAttempts;
+	GenerationStats.OverlapTests = ActivePlan.OverlapTests;
+	GenerationStats.NearMissQueries = ActivePlan.NearMissQueries;
+	GenerationStats.PortalFallbacks = ActivePlan.PortalFallbackCount;
+	GenerationStats.PortalsAvoided = ActivePlan.AvoidedPortalCount;
+	GenerationStats.IsLayoutFromCache = ActivePlan.IsFromCache;
+	GenerationStats.End();
+	UE_LOG(LogSpawn, Verbose, TEXT("%s"), *GenerationStats.ToString());
+
+	if (PrepareNextMapDuringRun && TestRoomContainer && ActiveRoomContainer.Get() == TestRoomContainer)
+	{
+		PrepareNextGeneration();
+	}
+}
+
+void AMapGenerator::TickInstantiation()
+{
+	if (PendingLayout.IsValid())
+	{
+		if (!PendingLayout.IsReady())
+		{
+			return;
+		}
+		FMapLayoutPlan Plan = PendingLayout.Get();
+		PendingLayout.Reset();
+		GenerationStats.AddSample(EMapGenerationPhase::Layout, Plan.SolveStartSeconds, Plan.SolveSeconds);
+		if (Plan.IsEmpty())
+		{
+			PVD_LOG(Error, TEXT("Map layout could not be solved for seed %u"), InitialSeed);
+			GenerationStats.End();
+			IsGenerationInProgress = false;
+			MapGenerationFailedHandler.Broadcast(static_cast<int32>(InitialSeed));
+			return;
+		}
+		BeginInstantiation(ActiveRoomContainer.Get(), MoveTemp(Plan));
+	}
+
+	const double BudgetEndTime = FPlatformTime::Seconds() + SpawnBudgetMilliseconds / 1000.0;
+	/** At least one room per frame so a low budget can't stall the generation */
+	do
+	{
+		InstantiatePlannedRoom(NextPlannedRoomIndex++);
+	}
+	while (NextPlannedRoomIndex < ActivePlan.Rooms.Num() && FPlatformTime::Seconds() < BudgetEndTime);
+
+	MapGenerationProgressHandler.Broadcast(GetGenerationProgress());
+
+	if (NextPlannedRoomIndex >= ActivePlan.Rooms.Num())
+	{
+		FinishInstantiation();
+		IsGenerationInProgress = false;
+		MapGenerationCompletedHandler.Broadcast();
+	}
+}
+
+void AMapGenerator::PrepareNextGeneration()
+{
+	PrepareNextMap(TestRoomContainer, MakeTestGenerationParams());
+}
+
+void AMapGenerator::PrepareNextMap(const UPCGRoomContainer* const RoomContainer, const FMapGenerationParams& MapGenerationParams)
+{
+	if (RoomContainer == nullptr)
+	{
+		return;
+	}
+	DiscardNextMap();
+	NextMapRoomContainer = RoomContainer;
+	NextMapParams = MapGenerationParams;
+	PendingNextLayout = LaunchLayoutSolve(RoomContainer, MapGenerationParams);
+}
+
+bool AMapGenerator::HasNextMap() const
+{
+	return NextMapRoomContainer.IsValid() && (PendingNextLayout.IsValid() || !NextMapPlan.IsEmpty());
+}
+
+void AMapGenerator::TakeNextLayout()
+{
+	NextMapPlan = PendingNextLayout.Get();
+	PendingNextLayout.Reset();
+	if (NextMapPlan.IsEmpty())
+	{
+		PVD_LOG(Error, TEXT("Next map layout could not be solved for seed %u"), NextMapParams.Seed);
+		NextMapRoomContainer.Reset();
+		return;
+	}
+	UE_LOG(LogSpawn, Log, TEXT("Next map with seed %u prepared in %.2f ms"), NextMapParams.Seed, NextMapPlan.SolveSeconds * 1000.0);
+}
+
+void AMapGenerator::TickNextMapPrespawn()
+{
+	const UPCGRoomContainer* RoomContainer = NextMapRoomContainer.Get();
+	if (RoomContainer == nullptr)
+	{
+		return;
+	}
+	TRACE_CPUPROFILER_EVENT_SCOPE(MapGeneration_NextMapPrespawn);
+	const double BudgetEndTime = FPlatformTime::Seconds() + PrespawnBudgetMilliseconds / 1000.0;
+	/** At least one room per frame, the current run keeps most of the frame */
+	do
+	{
+		const FMapLayoutRoom& PlannedRoom = NextMapPlan.Rooms[NextMapRooms.Num()];
+		FTransform StagingTransform = PlannedRoom.Transform;
+		StagingTransform.AddToTranslation(NextMapStagingOffset);
+		ARoom* Room = AcquirePooledActor<ARoom>(GetPlannedRoomClass(RoomContainer, PlannedRoom), StagingTransform);
+		if (Room)
+		{
+			Room->SetActorHiddenInGame(true);
+			Room->SetActorEnableCollision(false);
+			Room->SetActorTickEnabled(false);
+		}
+		NextMapRooms.Add(Room);
+	}
+	while (NextMapRooms.Num() < NextMapPlan.Rooms.Num() && FPlatformTime::Seconds() < BudgetEndTime);
+}
+
+bool AMapGenerator::SwapToNextMap()
+{
+	if (IsGenerationInProgress || IsChunkedMapActive)
+	{
+		PVD_LOG(Warning, TEXT("Map generation is already in progress!"));
+		return false;
+	}
+	if (PendingNextLayout.IsValid())
+	{
+		/** Asked for before the worker finished, waiting for it is still cheaper than solving again */
+		PendingNextLayout.Wait();
+		TakeNextLayout();
+	}
+	const UPCGRoomContainer* RoomContainer = NextMapRoomContainer.Get();
+	if (RoomContainer == nullptr || NextMapPlan.IsEmpty())
+	{
+		return false;
+	}
+
+	/** Games usually destroy the map themselves before they start the next one */
+	if (IsValid(GeneratedStartRoom) || !GeneratedBattleRooms.IsEmpty())
+	{
+		DestroyMap();
+	}
+
+	FMapLayoutPlan Plan = MoveTemp(NextMapPlan);
+	NextMapPlan = FMapLayoutPlan();
+	NextMapRoomContainer.Reset();
+	StagedPlanRooms = MoveTemp(NextMapRooms);
+	NextMapRooms.Reset();
+
+	CurrentNavmeshPoolIndex = 0;
+	InitialSeed = NextMapParams.Seed;
+	GeneratorRandom = FMapRandomStream(InitialSeed).Split(EMapRandomPurpose::Generator);
+	GenerationStats.Begin(InitialSeed, RecordGenerationTrace);
+	UE_LOG(LogSpawn, Log, TEXT("Swapping to the prepared map with seed %u, %d of %d rooms spawned ahead"), InitialSeed, StagedPlanRooms.Num(), Plan.Rooms.Num());
+	if (UseAsyncGeneration)
+	{
+		IsGenerationInProgress = true;
+		MapGenerationProgressHandler.Broadcast(0.f);
+		BeginInstantiation(RoomContainer, MoveTemp(Plan));
+		return true;
+	}
+	BeginInstantiation(RoomContainer, MoveTemp(Plan));
+	while (NextPlannedRoomIndex < ActivePlan.Rooms.Num())
+	{
+		InstantiatePlannedRoom(NextPlannedRoomIndex++);
+	}
+	FinishInstantiation();
+	MapGenerationCompletedHandler.Broadcast();
+	return true;
+}
+
+void AMapGenerator::DiscardNextMap()
+{
+	if (PendingNextLayout.IsValid())
+	{
+		PendingNextLayout.Wait();
+		PendingNextLayout.Reset();
+	}
+	for (ARoom* Room : NextMapRooms)
+	{
+		ReleasePooledActor(Room);
+	}
+	NextMapRooms.Reset();
+	NextMapPlan = FMapLayoutPlan();
+	NextMapRoomContainer.Reset();
+}
+
+ARoom* AMapGenerator::AcquirePlannedRoom(int32 PlannedRoomIndex)
+{
+	const FMapLayoutRoom& PlannedRoom = ActivePlan.Rooms[PlannedRoomIndex];
+	if (StagedPlanRooms.IsValidIndex(PlannedRoomIndex) && IsValid(StagedPlanRooms[PlannedRoomIndex]))
+	{
+		/** Spawned ahead while the last map was played, only moved into place and woken up */
+		ARoom* Room = StagedPlanRooms[PlannedRoomIndex];
+		StagedPlanRooms[PlannedRoomIndex] = nullptr;
+		Room->SetActorTransform(PlannedRoom.Transform, false, nullptr, ETeleportType::ResetPhysics);
+		Room->SetActorHiddenInGame(false);
+		Room->SetActorEnableCollision(true);
+		Room->SetActorTickEnabled(true);
+		return Room;
+	}
+	return AcquirePooledActor<ARoom>(GetPlannedRoomClass(ActiveRoomContainer.Get(), PlannedRoom), PlannedRoom.Transform);
+}
+
+void AMapGenerator::ReleaseStagedPlanRooms()
+{
+	for (ARoom* Room : StagedPlanRooms)
+	{
+		ReleasePooledActor(Room);
+	}
+	StagedPlanRooms.Reset();
+}
+
+void AMapGenerator::StartChunkedGeneration(const UPCGRoomContainer* const RoomContainer, const FMapGenerationParams& MapGenerationParams)
+{
+	if (RoomContainer == nullptr)
+	{
+		return;
+	}
+	if (IsGenerationInProgress || IsChunkedMapActive)
+	{
+		PVD_LOG(Warning, TEXT("Map generation is already in progress!"));
+		return;
+	}
+
+	CurrentNavmeshPoolIndex = 0;
+	InitialSeed = MapGenerationParams.Seed;
+	GeneratorRandom = FMapRandomStream(InitialSeed).Split(EMapRandomPurpose::Generator);
+	GenerationStats.Begin(InitialSeed, RecordGenerationTrace);
+	ActiveRoomContainer = RoomContainer;
+	/** The atlas is rendered once for a finished map, a chunked map is never finished */
+	IsBuildingMinimapAtlas = false;
+
+	FMapChunkSettings ChunkSettings;
+	ChunkSettings.RoomsPerChunk = RoomsPerChunk;
+	ChunkSettings.ChunkStride = ChunkStride;
+	ChunkPlanner = MakeShared<const FMapChunkPlanner>(BuildLayoutTemplates(RoomContainer), MakeLayoutSettings(MapGenerationParams), ChunkSettings);
+	PlayerChunkIndex = 0;
+	ChunkCheckTimer = ChunkCheckInterval;
+
+	/** The player starts in the first chunk, so it is spawned before this returns */
+	FMapLayoutChunk FirstLayout;
+	{
+		MAP_GENERATION_PHASE_SCOPE(GenerationStats, Layout);
+		FirstLayout = ChunkPlanner->SolveChunk(0);
+	}
+	if (FirstLayout.Plan.IsEmpty())
+	{
+		PVD_LOG(Error, TEXT("First chunk could not be solved for seed %u"), MapGenerationParams.Seed);
+		ChunkPlanner.Reset();
+		return;
+	}
+	IsChunkedMapActive = true;
+	FMapChunkInstance& FirstChunk = ActiveChunks.AddDefaulted_GetRef();
+	FirstChunk.Layout = MoveTemp(FirstLayout);
+	while (!FirstChunk.IsInstantiated())
+	{
+		InstantiateChunkRoom(FirstChunk);
+	}
+	FinishChunkInstantiation(FirstChunk);
+
+	const FMapLayoutPlan& FirstPlan = FirstChunk.Layout.Plan;
+	GenerationStats.RoomCount = FirstPlan.Rooms.Num();
+	GenerationStats.PlacementAttempts = FirstPlan.PlacementAttempts;
+	GenerationStats.OverlapTests = FirstPlan.OverlapTests;
+	GenerationStats.NearMissQueries = FirstPlan.NearMissQueries;
+	GenerationStats.PortalFallbacks = FirstPlan.PortalFallbackCount;
+	GenerationStats.PortalsAvoided = FirstPlan.AvoidedPortalCount;
+	GenerationStats.End();
+	UE_LOG(LogSpawn, Verbose, TEXT("%s"), *GenerationStats.ToString());
+}
+
+void AMapGenerator::RequestChunk(int32 ChunkIndex)
+{
+	const FMapChunkStitch Stitch = ChunkPlanner->MakeStitch(ChunkIndex, ActiveChunks.Last().Layout.Plan);
+	if (!Stitch.IsValid())
+	{
+		PVD_LOG(Warning, TEXT("Chunk %d has no free exit left, chunk %d can't be reached"), ChunkIndex - 1, ChunkIndex);
+	}
+	TSharedPtr<const FMapChunkPlanner> Planner = ChunkPlanner;
+	PendingChunk = Async(EAsyncExecution::ThreadPool, [Planner, ChunkIndex, Stitch]()
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(MapGeneration_ChunkLayout);
+		FMapLayoutChunk Chunk = Planner->SolveChunk(ChunkIndex);
+		Chunk.Stitch = Stitch;
+		return Chunk;
+	});
+}
+
+void AMapGenerator::TickChunkInstantiation()
+{
+	if (PendingChunk.IsValid())
+	{
+		if (!PendingChunk.IsReady())
+		{
+			return;
+		}
+		FMapLayoutChunk Layout = PendingChunk.Get();
+		PendingChunk.Reset();
+		if (Layout.Plan.IsEmpty())
+		{
+			PVD_LOG(Error, TEXT("Chunk %d could not be solved for seed %u"), Layout.ChunkIndex, InitialSeed);
+			return;
+		}
+		ActiveChunks.AddDefaulted_GetRef().Layout = MoveTemp(Layout);
+	}
+	if (ActiveChunks.IsEmpty() || ActiveChunks.Last().IsInstantiated())
+	{
+		return;
+	}
+
+	FMapChunkInstance& Chunk = ActiveChunks.Last();
+	const double BudgetEndTime = FPlatformTime::Seconds() + SpawnBudgetMilliseconds / 1000.0;
+	/** At least one room per frame so a low budget can't stall the chunk */
+	do
+	{
+		InstantiateChunkRoom(Chunk);
+	}
+	while (!Chunk.IsInstantiated() && FPlatformTime::Seconds() < BudgetEndTime);
+
+	if (Chunk.IsInstantiated())
+	{
+		FinishChunkInstantiation(Chunk);
+	}
+}
+
+void AMapGenerator::InstantiateChunkRoom(FMapChunkInstance& Chunk)
+{
+	const int32 PlannedRoomIndex = Chunk.Rooms.Num();
+	const FMapLayoutRoom* PlannedRoom = &Chunk.Layout.Plan.Rooms[PlannedRoomIndex];
+	ARoom* LastRoom = Chunk.Rooms.IsValidIndex(PlannedRoom->ParentIndex) ? Chunk.Rooms[PlannedRoom->ParentIndex] : nullptr;
+
+	/** Chunks are spawned in order and the window releases chunks only between two, so the chunk before is still there */
+	const bool IsStitched = PlannedRoomIndex == 0 && Chunk.Layout.Stitch.IsValid() && ActiveChunks.Num() > 1;
+	FMapLayoutRoom StitchedRoom;
+	if (IsStitched)
+	{
+		const FMapChunkInstance& PreviousChunk = ActiveChunks[ActiveChunks.Num() - 2];
+		LastRoom = PreviousChunk.Rooms.IsValidIndex(Chunk.Layout.Stitch.FromRoom) ? PreviousChunk.Rooms[Chunk.Layout.Stitch.FromRoom] : nullptr;
+		if (LastRoom == nullptr)
+		{
+			PVD_LOG(Warning, TEXT("Room %d of chunk %d was not spawned, chunk %d can't be reached"),
+				Chunk.Layout.Stitch.FromRoom, PreviousChunk.Layout.ChunkIndex, Chunk.Layout.ChunkIndex);
+		}
+		StitchedRoom = *PlannedRoom;
+		Chunk.Layout.Stitch.ApplyTo(StitchedRoom);
+		PlannedRoom = &StitchedRoom;
+	}
+
+	ARoom* Room = AcquirePooledActor<ARoom>(GetPlannedRoomClass(ActiveRoomContainer.Get(), *PlannedRoom), PlannedRoom->Transform);
+	Chunk.Rooms.Add(Room);
+	if (Room == nullptr)
+	{
+		return;
+	}
+
+	/** Connections add to the lists of the whole map, the chunk remembers its own to release them later */
+	const int32 FirstPortal = GeneratedPortals.Num();
+	const int32 FirstDoor = GeneratedDoors.Num();
+	SetUpSpawnedRoom(Room, *PlannedRoom, LastRoom, INDEX_NONE);
+	TArray<AActor*>& RoomPortals = IsStitched ? Chunk.StitchPortals : Chunk.Portals;
+	for (int32 Index = FirstPortal; Index < GeneratedPortals.Num(); Index++)
+	{
+		RoomPortals.Add(GeneratedPortals[Index]);
+	}
+	for (int32 Index = FirstDoor; Index < GeneratedDoors.Num(); Index++)
+	{
+		Chunk.Doors.Add(GeneratedDoors[Index]);
+	}
+	for (const FMapMinimapMarker& Marker : PendingMinimapMarkers)
+	{
+		(IsStitched && Marker.IsPortal ? Chunk.StitchMinimapMarkers : Chunk.MinimapMarkers).Add(Marker);
+	}
+	PendingMinimapMarkers.Reset();
+}
+
+void AMapGenerator::FinishChunkInstantiation(FMapChunkInstance& Chunk)
+{
+	{
+		MAP_GENERATION_PHASE_SCOPE(GenerationStats, Finish);
+		if (Chunk.Layout.ChunkIndex == 0 && IsValid(GeneratedStartRoom))
+		{
+			GeneratedStartRoom->HandleMinimap();
+		}
+		/** Same as PlacePlaceholderMeshesOnEntrances, but only for the rooms of this chunk */
+		for (int32 RoomIndex = 0; RoomIndex < Chunk.Rooms.Num(); RoomIndex++)
+		{
+			if (Chunk.Layout.Plan.Rooms[RoomIndex].Kind == EMapLayoutRoomKind::Battle && IsValid(Chunk.Rooms[RoomIndex]))
+			{
+				for (const auto Element : Chunk.Rooms[RoomIndex]->AvailableExitPoints)
 				{
-					//Check if room has available puzzle points
-					if(!BattleRoom->AvailablePuzzlePoints.IsEmpty())
-					{
-						TSubclassOf<APuzzleRoom> BPPuzzleRoom = PickRandomRoom<APuzzleRoom>(
-						PuzzleRooms, MapGenerationParams.MakePuzzleRoomsUnique);
-			
-						APuzzleRoom* PuzzleRoom = Cast<APuzzleRoom>(GetWorld()->SpawnActor(BPPuzzleRoom));
-
-						if (LastRoom != nullptr)
-						{
-							if (PuzzleRoom != nullptr)
-							{
-								LastRoom->SideRooms.Add(PuzzleRoom);
-								GeneratedPuzzleRooms.Add(PuzzleRoom);
-								PuzzleRoom->LastRoom = LastRoom;
-							}
-						}
-						else
-						{
-							GeneratedPuzzleRooms.Add(PuzzleRoom);
-						}
-						PlaceRoom(PuzzleRoom , true);
-						PuzzleRoom->EntitySpawner->SpawnEntities();
-						//Reset Puzzle Room Spawn Mechanic in every frequency
-						SpawnedPuzzleRoom = true;
-					}
+					ShowPlaceholderMesh(Element);
 				}
 			}
 		}
-		if (HasBossRoom)
+	}
+	Chunk.NavBounds = MoveTemp(PendingNavBounds);
+	UpdateChunkNavigationBounds();
+
+	if (Chunk.Layout.RoomsOutsideRegion > 0)
+	{
+		PVD_LOG(Warning, TEXT("%d rooms of chunk %d reach into other chunks, ChunkStride is too small"), Chunk.Layout.RoomsOutsideRegion, Chunk.Layout.ChunkIndex);
+	}
+	UE_LOG(LogSpawn, Log, TEXT("Chunk %d spawned with %d rooms, %d portal fallbacks"), Chunk.Layout.ChunkIndex, Chunk.Rooms.Num(), Chunk.Layout.Plan.PortalFallbackCount);
+}
+
+void AMapGenerator::UpdateChunkWindow()
+{
+	if (PendingChunk.IsValid() || ActiveChunks.IsEmpty() || !ActiveChunks.Last().IsInstantiated())
+	{
+		return;
+	}
+
+	/** The region gives the chunk, the rooms of that chunk confirm it. Outside of every room, e.g. in a safe room, the last chunk stays the player's */
+	if (const APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(GetWorld(), 0))
+	{
+		const FVector PlayerLocation = PlayerPawn->GetActorLocation();
+		const int32 ChunkIndex = ChunkPlanner->GetChunkAt(PlayerLocation);
+		const int32 Slot = ChunkIndex - ActiveChunks[0].Layout.ChunkIndex;
+		if (ActiveChunks.IsValidIndex(Slot))
+		{
+			for (const FMapLayoutRoom& PlannedRoom : ActiveChunks[Slot].Layout.Plan.Rooms)
+			{
+				if (PlannedRoom.WorldBounds.IsInside(PlayerLocation))
+				{
+					PlayerChunkIndex = ChunkIndex;
+					break;
+				}
+			}
+		}
+	}
+
+	bool HasReleasedChunk = false;
+	while (ActiveChunks.Num() > 1 && ActiveChunks[0].Layout.ChunkIndex < PlayerChunkIndex - ChunksBehind)
+	{
+		ReleaseFirstChunk();
+		HasReleasedChunk = true;
+	}
+	if (HasReleasedChunk)
+	{
+		UpdateChunkNavigationBounds();
+		RebuildChunkMinimap();
+	}
+
+	const int32 LastChunkIndex = ActiveChunks.Last().Layout.ChunkIndex;
+	if (LastChunkIndex < PlayerChunkIndex + ChunksAhead)
+	{
+		RequestChunk(LastChunkIndex + 1);
+	}
+}
+
+void AMapGenerator::ReleaseFirstChunk()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(MapGeneration_ReleaseChunk);
+	auto ReleasePortals = [this](const TArray<AActor*>& Portals)
+	{
+		for (AActor* Portal : Portals)
+		{
+			GeneratedPortals.RemoveSingleSwap(Cast<APortal>(Portal), false);
+			ReleasePooledActor(Portal);
+		}
+	};
+
+	FMapChunkInstance& Chunk = ActiveChunks[0];
+	for (int32 RoomIndex = 0; RoomIndex < Chunk.Rooms.Num(); RoomIndex++)
+	{
+		ARoom* Room = Chunk.Rooms[RoomIndex];
+		if (!IsValid(Room))
+		{
+			continue;
+		}
+		switch (Chunk.Layout.Plan.Rooms[RoomIndex].Kind)
+		{
+		case EMapLayoutRoomKind::Start:
+			GeneratedStartRoom = nullptr;
+			break;
+		case EMapLayoutRoomKind::Battle:
+			if (ABattleRoom* BattleRoom = Cast<ABattleRoom>(Room))
+			{
+				BattleRoom->EnemySpawner->DestroyEnemies();
+				GeneratedBattleRooms.RemoveSingleSwap(BattleRoom, false);
+			}
+			break;
+		case EMapLayoutRoomKind::Puzzle:
+			GeneratedPuzzleRooms.RemoveSingleSwap(Cast<APuzzleRoom>(Room), false);
+			break;
+		default:
+			break;
+		}
+		ReleasePooledActor(Room);
+	}
+	ReleasePortals(Chunk.Portals);
+	ReleasePortals(Chunk.StitchPortals);
+	for (AActor* Door : Chunk.Doors)
+	{
+		GeneratedDoors.RemoveSingleSwap(Door, false);
+		ReleasePooledActor(Door);
+	}
+
+	/** The way back from the next chunk led into this one */
+	if (ActiveChunks.IsValidIndex(1))
+	{
+		FMapChunkInstance& NextChunk = ActiveChunks[1];
+		ReleasePortals(NextChunk.StitchPortals);
+		NextChunk.StitchPortals.Reset();
+		NextChunk.StitchMinimapMarkers.Reset();
+		if (!NextChunk.Rooms.IsEmpty() && IsValid(NextChunk.Rooms[0]))
+		{
+			NextChunk.Rooms[0]->LastRoom = nullptr;
+		}
+	}
+	UE_LOG(LogSpawn, Log, TEXT("Chunk %d released"), Chunk.Layout.ChunkIndex);
+	ActiveChunks.RemoveAt(0);
+}
+
+void AMapGenerator::UpdateChunkNavigationBounds()
+{
+	PendingNavBounds.Reset();
+	for (const FMapChunkInstance& Chunk : ActiveChunks)
+	{
+		PendingNavBounds.Append(Chunk.NavBounds);
+	}
+	UpdateNavigationBounds();
+}
+
+void AMapGenerator::AddMinimapMarker(UMainHUDWidget* MainHUD, const FMapMinimapMarker& Marker)
+{
+	SpawnMinimapMarker(MainHUD, Marker);
+	if (IsChunkedMapActive)
+	{
+		PendingMinimapMarkers.Add(Marker);
+	}
+}
+
+void AMapGenerator::SpawnMinimapMarker(UMainHUDWidget* MainHUD, const FMapMinimapMarker& Marker)
+{
+	ARoom* Room = Marker.Room.Get();
+	if (Room == nullptr)
+	{
+		return;
+	}
+	if (Marker.IsPortal)
+	{
+		MainHUD->MiniMap->SpawnPortal(Room, Marker.Location, Marker.Yaw);
+	}
+	else
+	{
+		MainHUD->MiniMap->SpawnMap(Room, Room->GetMinimapTexture(), Marker.Location, Marker.Yaw);
+	}
+}
+
+void AMapGenerator::RebuildChunkMinimap()
+{
+	const auto MainHUD = GetMainHUD();
+	if (MainHUD == nullptr)
+	{
+		return;
+	}
+	MAP_GENERATION_PHASE_SCOPE(GenerationStats, Minimap);
+	MainHUD->MiniMap->ClearMapPanel();
+	MainHUD->InfoMap->ClearMapPanel();
+	/** The stitch portal sits on a room of the chunk before, which is on the minimap already */
+	for (const FMapChunkInstance& Chunk : ActiveChunks)
+	{
+		for (const FMapMinimapMarker& Marker : Chunk.StitchMinimapMarkers)
+		{
+			SpawnMinimapMarker(MainHUD, Marker);
+		}
+		for (const FMapMinimapMarker& Marker : Chunk.MinimapMarkers)
+		{
+			SpawnMinimapMarker(MainHUD, Marker);
+		}
+	}
+	if (IsValid(GeneratedStartRoom))
+	{
+		MainHUD->InfoMap->SpawnMap(GeneratedStartRoom, GeneratedStartRoom->GetMinimapTexture(), GeneratedStartRoom->GetActorLocation(), GeneratedStartRoom->GetActorRotation().Yaw);
+	}
+}
+
+void AMapGenerator::SpawnRoomEntities(ARoom* Room)
+{
+	if (auto const BattleRoom = Cast<ABattleRoom>(Room))
+	{
+		BattleRoom->EnemySpawner->SpawnEnemies();
+	}
+	else if (auto const PuzzleRoom = Cast<APuzzleRoom>(Room))
+	{
+		PuzzleRoom->EntitySpawner->SpawnEntities();
+	}
+	else if (auto const StartRoom = Cast<AStartRoom>(Room))
+	{
+		StartRoom->SafeRoomEntitySpawner->SpawnEntities();
+	}
+}
+
+bool AMapGenerator::DeferEntitySpawn(int32 PlannedRoomIndex, ARoom* Room)
+{
+	if (!UseDeferredEntitySpawning || !DeferredSpawnRooms.IsValidIndex(PlannedRoomIndex))
+	{
+		return false;
+	}
+	/** The player had already come close to it before the map was saved */
+	if (RestoredSpawnedRooms.IsValidIndex(PlannedRoomIndex) && RestoredSpawnedRooms[PlannedRoomIndex])
+	{
+		return false;
+	}
+	DeferredSpawnRooms[PlannedRoomIndex] = Room;
+	DeferredSpawnCount++;
+	return true;
+}
+
+void AMapGenerator::SpawnDeferredEntities(int32 PlannedRoomIndex, int32 LookAhead)
+{
+	if (ARoom* Room = DeferredSpawnRooms[PlannedRoomIndex])
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(MapGeneration_DeferredEntitySpawn);
+		DeferredSpawnRooms[PlannedRoomIndex] = nullptr;
+		DeferredSpawnCount--;
+		if (IsValid(Room))
+		{
+			/** Look ahead can reach rooms that are dormant, they get their floor back before anything spawns on it */
+			const bool IsDormant = DormantRooms.IsValidIndex(PlannedRoomIndex) && DormantRooms[PlannedRoomIndex];
+			if (IsDormant)
+			{
+				SetRoomDormant(PlannedRoomIndex, false);
+			}
+			SpawnRoomEntities(Room);
+			if (IsDormant)
+			{
+				SetRoomDormant(PlannedRoomIndex, true);
+			}
+		}
+	}
+	if (LookAhead <= 0)
+	{
+		return;
+	}
+	/** Rooms behind the doors and portals of this room, so they are ready before the player gets there */
+	const int32 Distance = RoomGraph.GetDistanceFromStart(PlannedRoomIndex);
+	for (const int32 Neighbour : RoomGraph.GetNeighbours(PlannedRoomIndex))
+	{
+		if (RoomGraph.GetDistanceFromStart(Neighbour) > Distance)
+		{
+			SpawnDeferredEntities(Neighbour, LookAhead - 1);
+		}
+	}
+}
+
+void AMapGenerator::TickDeferredEntitySpawns()
+{
+	const APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(GetWorld(), 0);
+	if (PlayerPawn == nullptr || DeferredSpawnRooms.Num() != ActivePlan.Rooms.Num())
+	{
+		return;
+	}
+	const FVector PlayerLocation = PlayerPawn->GetActorLocation();
+	PlannedRoomGrid.Query(FBox(PlayerLocation, PlayerLocation).ExpandBy(EntitySpawnDistance), PlannedRoomQueryResult);
+	for (const int32 PlannedRoomIndex : PlannedRoomQueryResult)
+	{
+		if (ActivePlan.Rooms[PlannedRoomIndex].WorldBounds.ExpandBy(EntitySpawnDistance).IsInside(PlayerLocation))
+		{
+			SpawnDeferredEntities(PlannedRoomIndex, EntitySpawnLookAhead);
+		}
+	}
+}
+
+int32 AMapGenerator::FindPlannedRoomAt(const FVector& Location)
+{
+	PlannedRoomGrid.Query(FBox(Location, Location), PlannedRoomQueryResult);
+	for (const int32 PlannedRoomIndex : PlannedRoomQueryResult)
+	{
+		if (ActivePlan.Rooms[PlannedRoomIndex].WorldBounds.IsInside(Location))
+		{
+			return PlannedRoomIndex;
+		}
+	}
+	return INDEX_NONE;
+}
+
+void AMapGenerator::BeginRoomDormancy()
+{
+	const int32 RoomCount = ActivePlan.Rooms.Num();
+	if (RoomCount == 0 || SpawnedPlanRooms.Num() != RoomCount)
+	{
+		return;
+	}
+	DormantRooms.Init(false, RoomCount);
+	NearRoomMask.Init(false, RoomCount);
+	AwakeRooms.SetNumUninitialized(RoomCount);
+	for (int32 RoomIndex = 0; RoomIndex < RoomCount; RoomIndex++)
+	{
+		AwakeRooms[RoomIndex] = RoomIndex;
+	}
+	IsRoomDormancyActive = true;
+	RoomDormancyCheckTimer = RoomDormancyCheckInterval;
+	/** The player enters the map in the start room */
+	UpdateRoomDormancy(0);
+}
+
+void AMapGenerator::UpdateRoomDormancy(int32 CenterRoomIndex)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(MapGeneration_RoomDormancy);
+	/** Only the neighbourhood is visited, rooms that didn't change state aren't touched */
+	TArray<int32> NearRooms;
+	RoomGraph.GetRoomsWithinHops(CenterRoomIndex, RoomActiveDepth, NearRooms);
+	for (const int32 RoomIndex : NearRooms)
+	{
+		NearRoomMask[RoomIndex] = true;
+	}
+	for (const int32 RoomIndex : AwakeRooms)
+	{
+		if (!NearRoomMask[RoomIndex])
+		{
+			SetRoomDormant(RoomIndex, true);
+		}
+	}
+	for (const int32 RoomIndex : NearRooms)
+	{
+		if (DormantRooms[RoomIndex])
+		{
+			SetRoomDormant(RoomIndex, false);
+		}
+		NearRoomMask[RoomIndex] = false;
+	}
+	AwakeRooms = MoveTemp(NearRooms);
+	PlayerRoomIndex = CenterRoomIndex;
+}
+
+void AMapGenerator::TickRoomDormancy()
+{
+	const APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(GetWorld(), 0);
+	if (PlayerPawn == nullptr)
+	{
+		return;
+	}
+	/** Outside of every room, e.g. in a safe room, the last neighbourhood stays active */
+	const int32 RoomIndex = FindPlannedRoomAt(PlayerPawn->GetActorLocation());
+	if (RoomIndex != INDEX_NONE && RoomIndex != PlayerRoomIndex)
+	{
+		UpdateRoomDormancy(RoomIndex);
+	}
+}
+
+void AMapGenerator::SetRoomDormant(int32 PlannedRoomIndex, bool IsDormant)
+{
+	DormantRooms[PlannedRoomIndex] = IsDormant;
+	ARoom* Room = SpawnedPlanRooms[PlannedRoomIndex];
+	if (!IsValid(Room))
+	{
+		DormantRoomActors.Remove(PlannedRoomIndex);
+		return;
+	}
+
+	bool HasRoomActors = false;
+	if (IsDormant)
+	{
+		TArray<TWeakObjectPtr<AActor>>& RoomActors = DormantRoomActors.FindOrAdd(PlannedRoomIndex);
+		GatherRoomActors(PlannedRoomIndex, RoomActors);
+		for (const TWeakObjectPtr<AActor>& RoomActor : RoomActors)
+		{
+			SetActorDormant(RoomActor.Get(), true);
+		}
+		HasRoomActors = !RoomActors.IsEmpty();
+	}
+	else if (TArray<TWeakObjectPtr<AActor>>* RoomActors = DormantRoomActors.Find(PlannedRoomIndex))
+	{
+		for (const TWeakObjectPtr<AActor>& RoomActor : *RoomActors)
 		{
-			if (Index == LinearRoomCount)
-			{
-				ABossRoom* BossRoom = nullptr;
-				while(BossRoom == nullptr)
-				{
-					TSubclassOf<ABossRoom> BPBossRoom = PickRandomRoom<ABossRoom>(BossRooms);
-					BossRoom = Cast<ABossRoom>(GetWorld()->SpawnActor(BPBossRoom));
-				}
-				if (LastRoom != nullptr)
-				{
-					if (BossRoom != nullptr)
-					{
-						LastRoom->NextRoom = BossRoom;
-						BossRoom->LastRoom = LastRoom;
-						GeneratedBossRooms = BossRoom;
-						LastRoom = BossRoom;
-					}
-				}
-				else
-				{
-					GeneratedBossRooms = BossRoom;
-					LastRoom = BossRoom;
-				}
-				
-				PlaceRoom(BossRoom);
-				BossRoom->SetUpPrepRoom();
-			}
+			SetActorDormant(RoomActor.Get(), false);
+		}
+		DormantRoomActors.Remove(PlannedRoomIndex);
+	}
+
+	SetActorDormant(Room, IsDormant);
+	/** Frozen pawns still stand on the floor, it only stops colliding in rooms nobody is left in */
+	Room->SetActorEnableCollision(!IsDormant || HasRoomActors);
+}
+
+void AMapGenerator::GatherRoomActors(int32 PlannedRoomIndex, TArray<TWeakObjectPtr<AActor>>& OutActors) const
+{
+	OutActors.Reset();
+	const ARoom* Room = SpawnedPlanRooms[PlannedRoomIndex];
+	const FBox& Bounds = ActivePlan.Rooms[PlannedRoomIndex].WorldBounds;
+	TArray<FOverlapResult> Overlaps;
+	const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(MapGeneratorRoomActors), false, Room);
+	GetWorld()->OverlapMultiByObjectType(Overlaps, Bounds.GetCenter(), FQuat::Identity, FCollisionObjectQueryParams(FCollisionObjectQueryParams::AllDynamicObjects),
+		FCollisionShape::MakeBox(Bounds.GetExtent()), QueryParams);
+
+	TArray<AActor*> RoomActors;
+	Room->GetAttachedActors(RoomActors);
+	for (const FOverlapResult& Overlap : Overlaps)
+	{
+		RoomActors.AddUnique(Overlap.GetActor());
+	}
+	for (AActor* Actor : RoomActors)
+	{
+		/** Pieces of the map and the player are handled by the map itself */
+		if (!IsValid(Actor) || Actor->IsA<ARoom>() || Actor->IsA<APortal>() || Actor->IsA<ADoor>())
+		{
+			continue;
+		}
+		const APawn* Pawn = Cast<APawn>(Actor);
+		if (Pawn && Pawn->IsPlayerControlled())
+		{
+			continue;
+		}
+		OutActors.Add(Actor);
+	}
+}
+
+void AMapGenerator::SetActorDormant(AActor* Actor, bool IsDormant)
+{
+	if (!IsValid(Actor))
+	{
+		return;
+	}
+	Actor->SetActorHiddenInGame(IsDormant);
+	Actor->SetActorTickEnabled(!IsDormant);
+	for (UActorComponent* Component : Actor->GetComponents())
+	{
+		/** Components that don't tick on their own are left alone when the actor wakes up */
+		if (Component && Component->PrimaryComponentTick.bStartWithTickEnabled)
+		{
+			Component->SetComponentTickEnabled(!IsDormant);
+		}
+	}
+	if (const APawn* Pawn = Cast<APawn>(Actor))
+	{
+		if (UMovementComponent* Movement = Pawn->GetMovementComponent(); Movement && IsDormant)
+		{
+			Movement->StopMovementImmediately();
+		}
+		/** AI keeps thinking in its controller, not in the pawn */
+		if (AController* Controller = Pawn->GetController())
+		{
+			Controller->SetActorTickEnabled(!IsDormant);
+		}
+	}
+}
+
+void AMapGenerator::EndRoomDormancy()
+{
+	/** Rooms go back to the pool awake, the pool only restores the actor itself */
+	for (TConstSetBitIterator<> It(DormantRooms); It; ++It)
+	{
+		if (SpawnedPlanRooms.IsValidIndex(It.GetIndex()))
+		{
+			SetRoomDormant(It.GetIndex(), false);
+		}
+	}
+	DormantRooms.Empty();
+	DormantRoomActors.Reset();
+	AwakeRooms.Reset();
+	NearRoomMask.Empty();
+	PlayerRoomIndex = INDEX_NONE;
+	IsRoomDormancyActive = false;
+}
+
+int32 AMapGenerator::GetPlannedRoomIndex(const ARoom* Room) const
+{
+	const int32* PlannedRoomIndex = PlannedRoomIndices.Find(Room);
+	return PlannedRoomIndex ? *PlannedRoomIndex : INDEX_NONE;
+}
+
+int32 AMapGenerator::GetRoomDistanceFromStart(const ARoom* Room) const
+{
+	const int32 PlannedRoomIndex = GetPlannedRoomIndex(Room);
+	return RoomGraph.IsValidRoom(PlannedRoomIndex) ? RoomGraph.GetDistanceFromStart(PlannedRoomIndex) : INDEX_NONE;
+}
+
+int32 AMapGenerator::GetRoomDistance(const ARoom* From, const ARoom* To) const
+{
+	return RoomGraph.GetDistance(GetPlannedRoomIndex(From), GetPlannedRoomIndex(To));
+}
+
+TArray<ARoom*> AMapGenerator::GetRoomsWithinHops(const ARoom* Room, int32 Hops) const
+{
+	TArray<int32> RoomIndices;
+	RoomGraph.GetRoomsWithinHops(GetPlannedRoomIndex(Room), Hops, RoomIndices);
+	TArray<ARoom*> Rooms;
+	Rooms.Reserve(RoomIndices.Num());
+	for (const int32 RoomIndex : RoomIndices)
+	{
+		if (SpawnedPlanRooms.IsValidIndex(RoomIndex) && SpawnedPlanRooms[RoomIndex])
+		{
+			Rooms.Add(SpawnedPlanRooms[RoomIndex]);
+		}
+	}
+	return Rooms;
+}
+
+UMainHUDWidget* AMapGenerator::GetMainHUD() const
+{
+	if (const auto PlayerController = Cast<APVDPlayerController> (UGameplayStatics::GetPlayerController(GetWorld(), 0)))
+	{
+		return PlayerController->GetHUDWidget();
+	}
+	return nullptr;
+}
+
+void AMapGenerator::AddRoomToMinimapAtlas(ARoom* Room, const FMapLayoutRoom& PlannedRoom)
+{
+	const int32 PlannedRoomIndex = static_cast<int32>(&PlannedRoom - ActivePlan.Rooms.GetData());
+	const FRoomTemplateData& TemplateData = GetRoomTemplateTable(ActiveRoomContainer.Get())->FindOrBake(Room->GetClass());
+	MinimapAtlasBuilder.AddRoom(Room, Room->GetMinimapTexture(), Room->GetActorTransform(), TemplateData.LocalBounds,
+		MinimapIslands.IsValidIndex(PlannedRoomIndex) ? MinimapIslands[PlannedRoomIndex] : 0);
+}
+
+void AMapGenerator::BuildMinimapAtlas()
+{
+	MAP_GENERATION_PHASE_SCOPE(GenerationStats, Minimap);
+	IsBuildingMinimapAtlas = false;
+	MinimapAtlas = MinimapAtlasBuilder.Build(this, MinimapAtlasPixelsPerUnit, MinimapAtlasMaxSize);
+	MinimapAtlasBuilder.Reset();
+	if (const auto MainHUD = GetMainHUD())
+	{
+		IMinimapAtlasReceiver::Execute_SetMinimapAtlas(MainHUD->MiniMap, MinimapAtlas);
+	}
+}
+
+ANavMeshBoundsVolume* AMapGenerator::GetOrCreateNavMeshVolume(int32 Index)
+{
+	if (NavMeshBoundsVolumePool.IsValidIndex(Index))
+	{
+		return NavMeshBoundsVolumePool[Index];
+	}
+	/** Brushes can't be built at runtime, new volumes copy the brush of the first pooled one */
+	if (NavMeshBoundsVolumePool.IsEmpty() || !IsValid(NavMeshBoundsVolumePool[0]))
+	{
+		PVD_LOG(Error, TEXT("NavMeshBoundsVolumePool needs at least one volume placed in the level!"));
+		return nullptr;
+	}
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.Template = NavMeshBoundsVolumePool[0];
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	ANavMeshBoundsVolume* NewVolume = GetWorld()->SpawnActor<ANavMeshBoundsVolume>(ANavMeshBoundsVolume::StaticClass(), SpawnParameters);
+	if (NewVolume)
+	{
+		NavMeshBoundsVolumePool.Add(NewVolume);
+	}
+	return NewVolume;
+}
+
+void AMapGenerator::UpdateNavigationBounds()
+{
+	MAP_GENERATION_PHASE_SCOPE(GenerationStats, NavMesh);
+	UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (NavSystem == nullptr)
+	{
+		PendingNavBounds.Reset();
+		return;
+	}
+
+	const TArray<FBox> MergedBounds = MergeNavBounds(PendingNavBounds, NavMeshMergeMaxWaste);
+	PendingNavBounds.Reset();
+
+	/** The navigation system collects every bounds change of this frame and rebuilds the touched tiles in one batch */
+	int32 UsedVolumeCount = 0;
+	for (const FBox& Bounds : MergedBounds)
+	{
+		ANavMeshBoundsVolume* NavVolume = GetOrCreateNavMeshVolume(UsedVolumeCount);
+		if (NavVolume == nullptr)
+		{
+			break;
+		}
+		UsedVolumeCount++;
+		const FVector BrushExtent = NavVolume->GetBrushComponent()->CalcBounds(FTransform::Identity).BoxExtent;
+		NavVolume->SetActorTransform(FTransform(FQuat::Identity, Bounds.GetCenter(), Bounds.GetExtent() / BrushExtent.ComponentMax(FVector(1.f))));
+		NavSystem->OnNavigationBoundsUpdated(NavVolume);
+#if ENABLE_DRAW_DEBUG
+		if (DrawNavigationBounds)
+		{
+			DrawDebugBox(GetWorld(), Bounds.GetCenter(), Bounds.GetExtent(), FColor::Green, false, 500, 0, 5.0f);
+		}
+#endif
+	}
+	/** Volumes of the last map that aren't needed anymore stop generating navigation */
+	for (int32 Index = UsedVolumeCount; Index < ActiveNavMeshVolumeCount && NavMeshBoundsVolumePool.IsValidIndex(Index); Index++)
+	{
+		NavSystem->OnNavigationBoundsRemoved(NavMeshBoundsVolumePool[Index]);
+	}
+	ActiveNavMeshVolumeCount = UsedVolumeCount;
+	CurrentNavmeshPoolIndex = UsedVolumeCount;
+
+	GenerationStats.NavMeshVolumeCount = UsedVolumeCount;
+	NavMeshBuildStartSeconds = FPlatformTime::Seconds();
+	IsWaitingForNavMeshBuild = UsedVolumeCount > 0;
+}
+
+void AMapGenerator::TickNavMeshBuild()
+{
+	const UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (NavSystem && NavSystem->IsNavigationBuildInProgress())
+	{
+		return;
+	}
+	IsWaitingForNavMeshBuild = false;
+	GenerationStats.NavMeshBuildMilliseconds = (FPlatformTime::Seconds() - NavMeshBuildStartSeconds) * 1000.0;
+	UE_LOG(LogSpawn, Log, TEXT("Navmesh of %d bounds volumes built in %.1f ms"), GenerationStats.NavMeshVolumeCount, GenerationStats.NavMeshBuildMilliseconds);
+}
+
+bool AMapGenerator::ExportGenerationTrace(const FString& FilePath) const
+{
+	if (!RecordGenerationTrace)
+	{
+		PVD_LOG(Warning, TEXT("Enable RecordGenerationTrace to export the phases of a generation"));
+	}
+	return GenerationStats.ExportTrace(FilePath.IsEmpty() ? FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("MapGenerationTrace.json")) : FilePath);
+}
+
+bool AMapGenerator::SaveMapSnapshot(TArray<uint8>& OutData) const
+{
+	if (IsGenerationInProgress || IsChunkedMapActive || ActivePlan.IsEmpty() || !ActiveRoomContainer.IsValid())
+	{
+		PVD_LOG(Warning, TEXT("Only a finished map can be saved"));
+		return false;
+	}
+	/** Rooms still waiting for deferred spawning are the ones the player never came close to */
+	TBitArray<> SpawnedRooms(true, ActivePlan.Rooms.Num());
+	for (int32 RoomIndex = 0; RoomIndex < DeferredSpawnRooms.Num(); RoomIndex++)
+	{
+		if (DeferredSpawnRooms[RoomIndex] != nullptr)
+		{
+			SpawnedRooms[RoomIndex] = false;
+		}
+	}
+	return FMapSnapshot::Save(ActivePlan, ActiveRoomContainer.Get(), SafeRooms, SpawnedRooms, OutData);
+}
+
+bool AMapGenerator::RestoreMapSnapshot(const UPCGRoomContainer* const RoomContainer, const TArray<uint8>& Data)
+{
+	if (RoomContainer == nullptr)
+	{
+		return false;
+	}
+	if (IsGenerationInProgress || IsChunkedMapActive)
+	{
+		PVD_LOG(Warning, TEXT("Map generation is already in progress!"));
+		return false;
+	}
+
+	const double StartSeconds = FPlatformTime::Seconds();
+	FMapLayoutPlan Plan;
+	FString Error;
+	GenerationStats.Begin(0, RecordGenerationTrace);
+	{
+		MAP_GENERATION_PHASE_SCOPE(GenerationStats, Layout);
+		if (!FMapSnapshot::Load(Data, RoomContainer, SafeRooms, GetRoomTemplateTable(RoomContainer), Plan, RestoredSpawnedRooms, Error))
+		{
+			PVD_LOG(Error, TEXT("Map snapshot could not be restored: %s"), *Error);
+			RestoredSpawnedRooms.Empty();
+			return false;
 		}
-		
 	}
-	if(IsValid(StartRoomRef))
+
+	CurrentNavmeshPoolIndex = 0;
+	InitialSeed = Plan.Seed;
+	GeneratorRandom = FMapRandomStream(InitialSeed).Split(EMapRandomPurpose::Generator);
+	GenerationStats.Seed = InitialSeed;
+	/** Nothing was solved, the stats report it like a layout from the cache */
+	Plan.IsFromCache = true;
+	BeginInstantiation(RoomContainer, MoveTemp(Plan));
+	while (NextPlannedRoomIndex < ActivePlan.Rooms.Num())
+	{
+		InstantiatePlannedRoom(NextPlannedRoomIndex++);
+	}
+	FinishInstantiation();
+	RestoredSpawnedRooms.Empty();
+	UE_LOG(LogSpawn, Log, TEXT("Restored map with seed %u and %d rooms from a %d byte snapshot in %.2f ms"), InitialSeed, ActivePlan.Rooms.Num(), Data.Num(),
+		(FPlatformTime::Seconds() - StartSeconds) * 1000.0);
+	MapGenerationCompletedHandler.Broadcast();
+	return true;
+}
+
+bool AMapGenerator::SaveMapSnapshotToFile(const FString& FilePath) const
+{
+	TArray<uint8> Data;
+	return SaveMapSnapshot(Data) && FFileHelper::SaveArrayToFile(Data, *(FilePath.IsEmpty() ? FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("MapSnapshot.bin")) : FilePath));
+}
+
+bool AMapGenerator::RestoreMapSnapshotFromFile(const UPCGRoomContainer* const RoomContainer, const FString& FilePath)
+{
+	const FString SnapshotPath = FilePath.IsEmpty() ? FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("MapSnapshot.bin")) : FilePath;
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *SnapshotPath, FILEREAD_Silent))
+	{
+		PVD_LOG(Error, TEXT("Map snapshot %s could not be read"), *SnapshotPath);
+		return false;
+	}
+	return RestoreMapSnapshot(RoomContainer, Data);
+}
+
+void AMapGenerator::CancelGeneration()
+{
+	if (PendingLayout.IsValid())
+	{
+		PendingLayout.Wait();
+		PendingLayout.Reset();
+	}
+	if (PendingChunk.IsValid())
 	{
-		StartRoomRef->HandleMinimap();
+		PendingChunk.Wait();
+		PendingChunk.Reset();
 	}
-	PlacePlaceholderMeshesOnEntrances();
+	ReleaseStagedPlanRooms();
+	/** Chunk actors are in the lists of the whole map as well, DestroyMap releases them from there */
+	ActiveChunks.Reset();
+	PendingMinimapMarkers.Reset();
+	ChunkPlanner.Reset();
+	IsChunkedMapActive = false;
+	SpawnedPlanRooms.Reset();
+	PlannedRoomIndices.Reset();
+	RoomGraph.Reset();
+	ActivePlan = FMapLayoutPlan();
+	NextPlannedRoomIndex = 0;
+	IsGenerationInProgress = false;
 }
 
 void AMapGenerator::DestroyMap()
 {
+	EndRoomDormancy();
+	CancelGeneration();
+
 	GES_EMIT_CONTEXT(this, "pvd.gameplay", "mapgenerator.destroyingmap");
 	FGESHandler::DefaultHandler()->EmitEvent(GESEmitContext, this);
 	
@@ -505,41 +1976,40 @@ void AMapGenerator::DestroyMap()
 	}
 	for (AActor* BattleRoom : GeneratedBattleRooms)
 	{
-		if (BattleRoom && BattleRoom->IsValidLowLevel())
-		{
-			BattleRoom->Destroy();
-		}
+		ReleasePooledActor(BattleRoom);
 	}
 	for (AActor* Portal : GeneratedPortals)
 	{
-		if (Portal && Portal->IsValidLowLevel())
-		{
-			Portal->Destroy();
-		}
+		ReleasePooledActor(Portal);
 	}
 	for (APuzzleRoom* PuzzleRoom : GeneratedPuzzleRooms)
 	{
-		if (PuzzleRoom && PuzzleRoom->IsValidLowLevel())
-		{
-			PuzzleRoom->Destroy();
-		}
+		ReleasePooledActor(PuzzleRoom);
 	}
 	for (ASafeRoom* SafeRoom : GeneratedSafeRooms)
 	{
 		if (SafeRoom && SafeRoom->IsValidLowLevel())
 		{
-			SafeRoom->Destroy();
+			DestroyGeneratedActor(SafeRoom);
 		}
 	}
 	for (AActor* GeneratedDoor : GeneratedDoors)
 	{
-		if (GeneratedDoor && GeneratedDoor->IsValidLowLevel())
+		ReleasePooledActor(GeneratedDoor);
+	}
+
+	DeferredSpawnRooms.Reset();
+	DeferredSpawnCount = 0;
+	PlannedRoomGrid.Reset(FMapLayoutSettings().SpatialGridCellSize);
+	/** Points of rooms destroyed instead of pooled */
+	for (auto It = PointsWithPlaceholder.CreateIterator(); It; ++It)
+	{
+		if (!It->IsValid())
 		{
-			GeneratedDoor->Destroy();
+			It.RemoveCurrent();
 		}
 	}
 
-	GeneratedStartRoom->Destroy();
 	GeneratedBattleRooms.Empty();
 	GeneratedPortals.Empty();
 	GeneratedPuzzleRooms.Empty();
@@ -549,24 +2019,204 @@ void AMapGenerator::DestroyMap()
 	if(IsValid(GeneratedBossRooms))
 	{
 		GeneratedBossRooms->EntitySpawner->DestroyEntities();
-		GeneratedBossRooms->BossRoomEntrancePortalRef->Destroy();
-		GeneratedBossRooms->Destroy();
+		DestroyGeneratedActor(GeneratedBossRooms->BossRoomEntrancePortalRef);
+		ReleasePooledActor(GeneratedBossRooms);
 	}
+	GeneratedBossRooms = nullptr;
 
-	if(IsValid(GeneratedStartRoom))
+	ReleasePooledActor(GeneratedStartRoom);
+	GeneratedStartRoom = nullptr;
+	
+	MinimapAtlas = FMinimapAtlas();
+	if (const auto MainHUD = GetMainHUD())
 	{
-		GeneratedStartRoom->Destroy();
+		MainHUD->MiniMap->ClearMapPanel();
+		MainHUD->InfoMap->ClearMapPanel();
+		MainHUD->MiniMap->SpawnHubMap();
+		MainHUD->InfoMap->SpawnHubMap();
 	}
-	
-	if (const auto PlayerController = Cast<APVDPlayerController> (UGameplayStatics::GetPlayerController(GetWorld(), 0)))
+	//Add Desctruction of entities here.
+}
+
+void AMapGenerator::DestroyGeneratedActor(AActor* Actor)
+{
+	if (!IsValid(Actor))
+	{
+		return;
+	}
+	if (!UseIncrementalTeardown)
+	{
+		Actor->Destroy();
+		return;
+	}
+	/** Gone for the player right away, the actual destruction is spread over the next frames */
+	Actor->SetActorHiddenInGame(true);
+	Actor->SetActorEnableCollision(false);
+	Actor->SetActorTickEnabled(false);
+	if (PendingDestroyActors.IsEmpty())
 	{
-		if (const auto MainHUD = PlayerController->GetHUDWidget())
+		TeardownFrameCount = 0;
+		TeardownDestroyedCount = 0;
+	}
+	PendingDestroyActors.Add(Actor);
+}
+
+void AMapGenerator::TickTeardown()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(MapGeneration_Teardown);
+	TeardownFrameCount++;
+	const double BudgetEndTime = FPlatformTime::Seconds() + TeardownBudgetMilliseconds / 1000.0;
+	/** At least one actor per frame so a low budget can't stall the teardown */
+	do
+	{
+		AActor* Actor = PendingDestroyActors.Pop(false);
+		if (IsValid(Actor))
 		{
-			MainHUD->MiniMap->ClearMapPanel();
-			MainHUD->InfoMap->ClearMapPanel();
-			MainHUD->MiniMap->SpawnHubMap();
-			MainHUD->InfoMap->SpawnHubMap();
+			Actor->Destroy();
+			TeardownDestroyedCount++;
 		}
 	}
-	//Add Desctruction of entities here.
+	while (!PendingDestroyActors.IsEmpty() && FPlatformTime::Seconds() < BudgetEndTime);
+
+	if (PendingDestroyActors.IsEmpty())
+	{
+		UE_LOG(LogSpawn, Log, TEXT("Map teardown destroyed %d actors over %d frames"), TeardownDestroyedCount, TeardownFrameCount);
+		/** One collection for the whole map instead of the engine picking a moment in the middle of the hub */
+		if (CollectGarbageAfterTeardown && GEngine)
+		{
+			GEngine->ForceGarbageCollection(false);
+		}
+	}
+}
+
+AActor* AMapGenerator::AcquirePooledActor(UClass* ActorClass, const FTransform& Transform)
+{
+	if (ActorClass == nullptr)
+	{
+		return nullptr;
+	}
+	MAP_GENERATION_PHASE_SCOPE(GenerationStats, SpawnActor);
+
+	if (FMapActorPoolEntry* PoolEntry = ActorPool.Find(ActorClass))
+	{
+		while (!PoolEntry->Actors.IsEmpty())
+		{
+			AActor* PooledActor = PoolEntry->Actors.Pop(false);
+			if (!IsValid(PooledActor))
+			{
+				continue;
+			}
+			ActorPoolStats.Hits++;
+			PooledActor->SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+			PooledActor->SetActorHiddenInGame(false);
+			PooledActor->SetActorEnableCollision(true);
+			PooledActor->SetActorTickEnabled(true);
+			return PooledActor;
+		}
+	}
+
+	ActorPoolStats.Misses++;
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	return GetWorld()->SpawnActor(ActorClass, &Transform, SpawnParameters);
+}
+
+void AMapGenerator::ReleasePooledActor(AActor* Actor)
+{
+	if (!IsValid(Actor))
+	{
+		return;
+	}
+
+	FMapActorPoolEntry& PoolEntry = ActorPool.FindOrAdd(Actor->GetClass());
+	if (PoolEntry.Actors.Contains(Actor))
+	{
+		return;
+	}
+	if (!UseActorPool || PoolEntry.Actors.Num() >= MaxPooledActorsPerClass)
+	{
+		ActorPoolStats.Destroyed++;
+		DestroyGeneratedActor(Actor);
+		return;
+	}
+
+	ResetPooledActor(Actor);
+	Actor->SetActorHiddenInGame(true);
+	Actor->SetActorEnableCollision(false);
+	Actor->SetActorTickEnabled(false);
+	PoolEntry.Actors.Add(Actor);
+	ActorPoolStats.Recycled++;
+}
+
+void AMapGenerator::ResetPooledActor(AActor* Actor)
+{
+	if (APortal* Portal = Cast<APortal>(Actor))
+	{
+		Portal->TeleportTargetPoint = nullptr;
+		Portal->SetConnectedRoom(nullptr);
+		Portal->Disable();
+		if (ASafeRoomPortal* SafeRoomPortal = Cast<ASafeRoomPortal>(Portal))
+		{
+			SafeRoomPortal->ConnectedSafeRoom = nullptr;
+		}
+		for (AActor* SafeRoomActor : SafeRooms)
+		{
+			if (ASafeRoom* SafeRoom = Cast<ASafeRoom>(SafeRoomActor))
+			{
+				SafeRoom->ConnectedPortals.Remove(Portal);
+			}
+		}
+	}
+	else if (ADoor* Door = Cast<ADoor>(Actor))
+	{
+		Door->SetConnectedRoom(nullptr);
+	}
+	else if (ARoom* Room = Cast<ARoom>(Actor))
+	{
+		Room->LastRoom = nullptr;
+		Room->NextRoom = nullptr;
+		Room->SideRooms.Empty();
+		/** A fresh room has no placeholders, ShowPlaceholderMesh turns the spawned ones on again where the next map needs them */
+		Room->AvailableExitPoints.Reset();
+		for (URoomExitPoint* ExitPoint : GetOrderedPoints<URoomExitPoint>(Room))
+		{
+			ExitPoint->SetActivationOfPlaceholderMeshes(false);
+			Room->AvailableExitPoints.Add(ExitPoint);
+		}
+		Room->AvailablePuzzlePoints.Reset();
+		for (UPuzzleRoomConnectionPoint* PuzzlePoint : GetOrderedPoints<UPuzzleRoomConnectionPoint>(Room))
+		{
+			PuzzlePoint->SetActivationOfPlaceholderMeshes(false);
+			Room->AvailablePuzzlePoints.Add(PuzzlePoint);
+		}
+		if (IsValid(Room->EntrancePoint))
+		{
+			Room->EntrancePoint->SetActivationOfPlaceholderMeshes(false);
+		}
+		if (ABattleRoom* BattleRoom = Cast<ABattleRoom>(Room))
+		{
+			BattleRoom->EnemySpawner->DestroyEnemies();
+		}
+		else if (APuzzleRoom* PuzzleRoom = Cast<APuzzleRoom>(Room))
+		{
+			PuzzleRoom->EntitySpawner->DestroyEntities();
+			PuzzleRoom->PuzzleRoomEntrancePortalRef = nullptr;
+		}
+		else if (AStartRoom* StartRoom = Cast<AStartRoom>(Room))
+		{
+			StartRoom->SafeRoomEntitySpawner->DestroyEntities();
+		}
+	}
+}
+
+void AMapGenerator::EmptyActorPool()
+{
+	for (auto& PoolEntry : ActorPool)
+	{
+		for (AActor* PooledActor : PoolEntry.Value.Actors)
+		{
+			DestroyGeneratedActor(PooledActor);
+		}
+	}
+	ActorPool.Empty();
 }
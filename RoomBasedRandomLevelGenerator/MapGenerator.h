@@ -4,16 +4,90 @@
 
 #include "CoreMinimal.h"
 #include "EndMapPortal.h"
+#include "MapChunkPlanner.h"
+#include "MapGenerationStats.h"
+#include "MapLayoutGraph.h"
+#include "MapLayoutSolver.h"
+#include "MinimapAtlas.h"
 #include "PCGStructs.h"
 #include "GameFramework/Actor.h"
 #include "NavMesh/NavMeshBoundsVolume.h"
 #include "PVD/Data/PCGRoomContainer.h"
 #include "MapGenerator.generated.h"
 
+class ARoom;
 class ASafeRoom;
 class URoomConnectionPoint;
+class URoomTemplateTable;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FMapGenerationCompletedDelegate);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FMapGenerationProgressDelegate, float, Progress);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FMapGenerationFailedDelegate, int32, Seed);
+
+/** Deactivated actors of one class waiting to be reused by the next generation */
+USTRUCT()
+struct FMapActorPoolEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<AActor*> Actors;
+};
+
+USTRUCT(BlueprintType)
+struct FMapActorPoolStats
+{
+	GENERATED_BODY()
+
+	/** Acquired actors that came from the pool */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 Hits = 0;
+	/** Acquired actors that had to be spawned */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 Misses = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 Recycled = 0;
+	/** Released actors that were destroyed because their class pool was full */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 Destroyed = 0;
+};
+
+/** Room or portal as it was put on the minimap, chunked maps replay these when a chunk is released */
+struct FMapMinimapMarker
+{
+	TWeakObjectPtr<ARoom> Room;
+	FVector Location = FVector::ZeroVector;
+	float Yaw = 0.f;
+	bool IsPortal = false;
+};
+
+/** Actors and plan of one instantiated chunk of a chunked map */
+USTRUCT()
+struct FMapChunkInstance
+{
+	GENERATED_BODY()
+
+	/** Indexed like the rooms of the chunk plan */
+	UPROPERTY()
+	TArray<ARoom*> Rooms;
+	UPROPERTY()
+	TArray<AActor*> Portals;
+	UPROPERTY()
+	TArray<AActor*> Doors;
+	/** Portal pair between the previous chunk and the first room, released with whichever of the two chunks goes first */
+	UPROPERTY()
+	TArray<AActor*> StitchPortals;
+
+	/** Minimap entries of the chunk's rooms, the ones of the stitch go with StitchPortals */
+	TArray<FMapMinimapMarker> MinimapMarkers;
+	TArray<FMapMinimapMarker> StitchMinimapMarkers;
+
+	FMapLayoutChunk Layout;
+	/** World bounds of the nav boxes of the chunk's rooms */
+	TArray<FBox> NavBounds;
+
+	bool IsInstantiated() const { return Rooms.Num() >= Layout.Plan.Rooms.Num(); }
+};
 
 UCLASS()
 class PVD_API AMapGenerator : public AActor
@@ -25,32 +99,199 @@ public:
 
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	
 public:
 	virtual void Tick(float DeltaTime) override;
 
 	UFUNCTION()
 	void StartGeneration();
+	/** Solves the layout on a worker thread, rooms are then spawned over several frames from Tick */
+	UFUNCTION()
+	void StartAsyncGeneration(const UPCGRoomContainer* RoomContainer, const FMapGenerationParams& MapGenerationParams);
+	/**
+	 * Builds an endless map chunk by chunk. The first chunk is spawned right away, later chunks are solved in the background
+	 * while the player gets close to them and chunks the player left behind are released again.
+	 */
+	UFUNCTION()
+	void StartChunkedGeneration(const UPCGRoomContainer* RoomContainer, const FMapGenerationParams& MapGenerationParams);
+	/**
+	 * Solves the layout of the map after this one in the background and, with PrespawnNextMap, spawns its rooms hidden at
+	 * NextMapStagingOffset over the next frames. SwapToNextMap then only has to move them into place.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void PrepareNextMap(const UPCGRoomContainer* RoomContainer, const FMapGenerationParams& MapGenerationParams);
+	/** PrepareNextMap with the test room container and a new seed, what StartGeneration would generate */
+	UFUNCTION(BlueprintCallable)
+	void PrepareNextGeneration();
+	UFUNCTION(BlueprintPure)
+	bool HasNextMap() const;
+	/** Destroys the current map and instantiates the prepared one, false when nothing was prepared */
+	UFUNCTION(BlueprintCallable)
+	bool SwapToNextMap();
+	/** Drops the prepared map, its spawned rooms go back to the actor pool */
+	UFUNCTION(BlueprintCallable)
+	void DiscardNextMap();
+	/** Chunk of the chunked map the player was last seen in */
+	UFUNCTION(BlueprintPure)
+	FORCEINLINE int32 GetPlayerChunkIndex() const { return PlayerChunkIndex; }
+	UFUNCTION(BlueprintPure)
+	FORCEINLINE bool IsGenerating() const { return IsGenerationInProgress; }
+	/** 0 while the layout is solved, then the ratio of spawned rooms */
+	UFUNCTION(BlueprintPure)
+	float GetGenerationProgress() const;
+	/** Phase timings and counters of the current or last generation */
+	UFUNCTION(BlueprintPure)
+	FMapGenerationStats GetGenerationStats() const { return GenerationStats; }
+	/** Writes the phases of the last generation as Chrome trace JSON, Saved/MapGenerationTrace.json by default */
+	UFUNCTION(BlueprintCallable)
+	bool ExportGenerationTrace(const FString& FilePath) const;
+	/** Current map as a compact FMapSnapshot blob, false while a map is generated or for chunked maps */
+	UFUNCTION(BlueprintCallable)
+	bool SaveMapSnapshot(TArray<uint8>& OutData) const;
+	/**
+	 * Instantiates a map saved with SaveMapSnapshot without solving its layout. Fails when the blob is broken or the
+	 * container or level lost a room class, portal class or safe room the map uses.
+	 */
+	UFUNCTION(BlueprintCallable)
+	bool RestoreMapSnapshot(const UPCGRoomContainer* RoomContainer, const TArray<uint8>& Data);
+	/** Saved/MapSnapshot.bin by default */
+	UFUNCTION(BlueprintCallable)
+	bool SaveMapSnapshotToFile(const FString& FilePath) const;
+	UFUNCTION(BlueprintCallable)
+	bool RestoreMapSnapshotFromFile(const UPCGRoomContainer* RoomContainer, const FString& FilePath);
+	/** Connections of the current map, room ids are the indices of the planned rooms */
+	FORCEINLINE const FMapLayoutGraph& GetRoomGraph() const { return RoomGraph; }
+	/** Room id of a room of the current map in GetRoomGraph, INDEX_NONE for any other room */
+	int32 GetPlannedRoomIndex(const ARoom* Room) const;
+	/** Doors and portals between the start room and the room, INDEX_NONE when it isn't part of the map */
+	UFUNCTION(BlueprintPure)
+	int32 GetRoomDistanceFromStart(const ARoom* Room) const;
+	UFUNCTION(BlueprintPure)
+	int32 GetRoomDistance(const ARoom* From, const ARoom* To) const;
+	/** Rooms at most Hops doors or portals away ordered by distance, the room itself comes first */
+	UFUNCTION(BlueprintCallable)
+	TArray<ARoom*> GetRoomsWithinHops(const ARoom* Room, int32 Hops) const;
 private:
-	void PlaceRoom(class ARoom* Room, bool ConnectWithPortal = false , bool NextRoomPassingCondition = false);
+	void PlaceRoom(ARoom* Room, const FMapLayoutRoom& PlannedRoom, ARoom* RoomToConnect);
+	void ConnectRoomWithPortal(ARoom* Room, const FMapLayoutRoom& PlannedRoom, ARoom* RoomToConnect);
+	void ConnectRoomWithDoor(ARoom* Room, const FMapLayoutRoom& PlannedRoom, ARoom* RoomToConnect);
 	void PlacePlaceholderMeshesOnEntrances();
-	bool IsCollisionBlocked(class ARoom* Room , FVector const FinalRootLocation , FRotator const FinalRootRotation);
-	
+	/** Spawns the placeholder of the point once, pooled rooms get their spawned placeholder turned on again */
+	void ShowPlaceholderMesh(URoomConnectionPoint* Point);
+	/** Physics check used by the layout solver for rooms that come close to level geometry */
+	bool IsCollisionBlocked(const FRoomFootprint& Footprint, const FTransform& RoomTransform) const;
+
+	/** Builds the footprints of every room class of the container for the layout solver */
+	FMapLayoutTemplates BuildLayoutTemplates(const UPCGRoomContainer* RoomContainer);
+	/** Baked table of the container, or a table baked at runtime when none was assigned */
+	URoomTemplateTable* GetRoomTemplateTable(const UPCGRoomContainer* RoomContainer);
+	FMapLayoutSettings MakeLayoutSettings(const FMapGenerationParams& MapGenerationParams) const;
+	FMapGenerationParams MakeTestGenerationParams() const;
+	/** Solves the layout or loads it from the layout cache on a worker thread */
+	TFuture<FMapLayoutPlan> LaunchLayoutSolve(const UPCGRoomContainer* RoomContainer, const FMapGenerationParams& MapGenerationParams);
+	FString MakeLayoutCacheKey(const UPCGRoomContainer* RoomContainer, const FMapLayoutTemplates& Templates, const FMapLayoutSettings& Settings, bool NearMissesBlocked) const;
+	static FString GetLayoutCacheDirectory();
+	static TSubclassOf<ARoom> GetPlannedRoomClass(const UPCGRoomContainer* RoomContainer, const FMapLayoutRoom& PlannedRoom);
+	static TSubclassOf<APortal> GetPlannedPortalClass(const UPCGRoomContainer* RoomContainer, const FMapLayoutRoom& PlannedRoom);
+
+	void BeginInstantiation(const UPCGRoomContainer* RoomContainer, FMapLayoutPlan&& Plan);
+	void InstantiatePlannedRoom(int32 PlannedRoomIndex);
+	/** Room spawned ahead for the planned room, or one from the actor pool */
+	ARoom* AcquirePlannedRoom(int32 PlannedRoomIndex);
+	/** Rooms spawned ahead that the map didn't use go back to the actor pool */
+	void ReleaseStagedPlanRooms();
+	void TakeNextLayout();
+	/** Spawns rooms of the prepared map until the prespawn budget is used up */
+	void TickNextMapPrespawn();
+	/** Links the room to its parent, connects it and spawns its entities, PlannedRoomIndex is INDEX_NONE for rooms outside ActivePlan */
+	void SetUpSpawnedRoom(ARoom* Room, const FMapLayoutRoom& PlannedRoom, ARoom* LastRoom, int32 PlannedRoomIndex);
+	void FinishInstantiation();
+	/** Spawns planned rooms until the frame budget is used up */
+	void TickInstantiation();
+	void CancelGeneration();
+	/** Moves the pooled navmesh bounds volumes over the merged nav boxes of the map in one batch */
+	void UpdateNavigationBounds();
+	/** Grows NavMeshBoundsVolumePool when the map needs more volumes than were placed */
+	ANavMeshBoundsVolume* GetOrCreateNavMeshVolume(int32 Index);
+	void TickNavMeshBuild();
+	class UMainHUDWidget* GetMainHUD() const;
+	static void SpawnRoomEntities(ARoom* Room);
+	/** Records the room for a spawn once the player comes close, false when deferred spawning is off */
+	bool DeferEntitySpawn(int32 PlannedRoomIndex, ARoom* Room);
+	void SpawnDeferredEntities(int32 PlannedRoomIndex, int32 LookAhead);
+	void TickDeferredEntitySpawns();
+	/** Planned room whose bounds contain the location, INDEX_NONE in corridors and level geometry */
+	int32 FindPlannedRoomAt(const FVector& Location);
+	/** Puts every room to sleep except the neighbourhood of the start room */
+	void BeginRoomDormancy();
+	/** Wakes the rooms within RoomActiveDepth of the center room and puts the rest of the last neighbourhood to sleep */
+	void UpdateRoomDormancy(int32 CenterRoomIndex);
+	void TickRoomDormancy();
+	void SetRoomDormant(int32 PlannedRoomIndex, bool IsDormant);
+	/** Enemies and entities the spawners put into the room, found by overlap with its planned bounds and by attachment */
+	void GatherRoomActors(int32 PlannedRoomIndex, TArray<TWeakObjectPtr<AActor>>& OutActors) const;
+	/** Hidden, not ticking and with its movement stopped, collision is left alone */
+	static void SetActorDormant(AActor* Actor, bool IsDormant);
+	void EndRoomDormancy();
+	/** Solves the chunk on a worker thread, the stitch to the last active chunk is decided here */
+	void RequestChunk(int32 ChunkIndex);
+	/** Takes a solved chunk and spawns its rooms until the frame budget is used up */
+	void TickChunkInstantiation();
+	void InstantiateChunkRoom(FMapChunkInstance& Chunk);
+	void FinishChunkInstantiation(FMapChunkInstance& Chunk);
+	/** Requests the chunks ahead of the player and releases the ones behind the window */
+	void UpdateChunkWindow();
+	void ReleaseFirstChunk();
+	/** Navigation covers the rooms of the active chunks only */
+	void UpdateChunkNavigationBounds();
+	/** Puts the marker on the minimap, chunked maps also keep it in PendingMinimapMarkers for the chunk */
+	void AddMinimapMarker(class UMainHUDWidget* MainHUD, const FMapMinimapMarker& Marker);
+	static void SpawnMinimapMarker(class UMainHUDWidget* MainHUD, const FMapMinimapMarker& Marker);
+	/** The minimap can't remove single rooms, it is cleared and gets the markers of the active chunks again */
+	void RebuildChunkMinimap();
+	void AddRoomToMinimapAtlas(ARoom* Room, const FMapLayoutRoom& PlannedRoom);
+	/** Renders the finished map into one texture and hands it to the minimap */
+	void BuildMinimapAtlas();
+
+	/** Reuses a pooled actor of the class or spawns a new one */
+	AActor* AcquirePooledActor(UClass* ActorClass, const FTransform& Transform);
 	template <class T>
-	TSubclassOf<T> PickRandomRoom(TArray<TSubclassOf<T>> RoomArray, bool RemovePickedRoomFromArray);
+	T* AcquirePooledActor(TSubclassOf<T> ActorClass, const FTransform& Transform) { return Cast<T>(AcquirePooledActor(ActorClass.Get(), Transform)); }
+	/** Deactivates the actor and resets its connections, destroys it when the class pool is full */
+	void ReleasePooledActor(AActor* Actor);
+	void ResetPooledActor(AActor* Actor);
+	/** Hides the actor and queues it for TickTeardown, or destroys it right away without incremental teardown */
+	void DestroyGeneratedActor(AActor* Actor);
+	/** Destroys queued actors until the frame budget is used up */
+	void TickTeardown();
 
 public:
 	
 	int CreateSeed() const;
 	UPROPERTY()
 	FMapGenerationCompletedDelegate MapGenerationCompletedHandler;
+	UPROPERTY(BlueprintAssignable)
+	FMapGenerationProgressDelegate MapGenerationProgressHandler;
+	/** The layout could not be solved, async generation broadcasts this instead of MapGenerationCompletedHandler */
+	UPROPERTY(BlueprintAssignable)
+	FMapGenerationFailedDelegate MapGenerationFailedHandler;
 	
 	int GetContinuousRandomInRange(unsigned int Min, unsigned int Max);
 
 	UFUNCTION()
 	void GenerateMap(const UPCGRoomContainer* RoomContainer, const FMapGenerationParams& MapGenerationParams);
+	/** Computes the layout or loads it from the layout cache, no actor is spawned */
+	FMapLayoutPlan SolveLayout(const UPCGRoomContainer* RoomContainer, const FMapGenerationParams& MapGenerationParams);
+	/** Spawns and connects the rooms of a solved layout */
+	void InstantiateLayout(const UPCGRoomContainer* RoomContainer, const FMapLayoutPlan& Plan);
 	UFUNCTION()
 	void DestroyMap();
+	UFUNCTION(BlueprintPure)
+	FORCEINLINE FMapActorPoolStats GetActorPoolStats() const { return ActorPoolStats; }
+	/** Destroys every pooled actor */
+	UFUNCTION()
+	void EmptyActorPool();
 	UFUNCTION()
 	FORCEINLINE URoomEntrancePoint* GetStartRoomConnectionPoint() const { return StartRoomEntrancePoint; }
 	
@@ -64,20 +305,118 @@ public:
 	TArray<AActor*> SafeRooms;
 	UPROPERTY(VisibleAnywhere)
 	int CurrentNavmeshPoolIndex = 0;
-	UPROPERTY(VisibleAnywhere)
-	bool IsLastRoomSafeRoom = false;
+	/** Nav boxes are merged as long as the merged box covers at most this much more than the boxes it replaces */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(ClampMin="0"))
+	float NavMeshMergeMaxWaste = 0.25f;
+	/** Enemies and entities of battle and puzzle rooms are spawned when the player comes close instead of during generation */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Entity spawning")
+	bool UseDeferredEntitySpawning = false;
+	/** Distance to a room's bounds at which its entities are spawned */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Entity spawning", meta=(EditCondition="UseDeferredEntitySpawning", ClampMin="0"))
+	float EntitySpawnDistance = 2000.f;
+	/** Rooms behind the doors and portals of a triggered room that are spawned along with it */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Entity spawning", meta=(EditCondition="UseDeferredEntitySpawning", ClampMin="0"))
+	int32 EntitySpawnLookAhead = 1;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Entity spawning", meta=(EditCondition="UseDeferredEntitySpawning", ClampMin="0"))
+	float DeferredSpawnCheckInterval = 0.2f;
+	/**
+	 * Only the room of the player and its neighbours are visible, collide and tick, every other room is dormant.
+	 * Enemies and entities of a dormant room are hidden and frozen with it, and a room with any of them keeps its collision
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Room streaming")
+	bool UseRoomDormancy = false;
+	/** Doors or portals between the player's room and the farthest room that is kept active */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Room streaming", meta=(EditCondition="UseRoomDormancy", ClampMin="1"))
+	int32 RoomActiveDepth = 1;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Room streaming", meta=(EditCondition="UseRoomDormancy", ClampMin="0"))
+	float RoomDormancyCheckInterval = 0.25f;
+	/** Minimaps implementing IMinimapAtlasReceiver get the whole map as one pre-rendered texture */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Minimap")
+	bool UseMinimapAtlas = true;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Minimap", meta=(EditCondition="UseMinimapAtlas", ClampMin="0.001"))
+	float MinimapAtlasPixelsPerUnit = 0.05f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Minimap", meta=(EditCondition="UseMinimapAtlas", ClampMin="256"))
+	int32 MinimapAtlasMaxSize = 4096;
+	/** StartGeneration solves the layout in the background and spawns the map across frames */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map generation")
+	bool UseAsyncGeneration = false;
+	/**
+	 * Solved layouts are saved per seed and parameters, a known seed skips placement and overlap tests.
+	 * Meant for seeds that come back, like daily challenges: every new seed adds a file under Saved/MapLayoutCache
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map generation")
+	bool UseLayoutCache = false;
+	/** Islands of door connected rooms are solved on all cores. Same map for every core count, but not the map of the sequential solve */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map generation")
+	bool UseParallelLayout = false;
+	/** A room whose door collides tries the other exits, room classes and parent exits before it is moved behind a portal */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map generation")
+	bool UseDoorPlacementSearch = true;
+	/** Door placements one room may test during that search */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map generation", meta=(ClampMin="1"))
+	int32 DoorSearchBudget = 64;
+	/** Every map started from the test room container prepares the next one as soon as it is spawned, StartGeneration then swaps to it */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Next map")
+	bool PrepareNextMapDuringRun = false;
+	/** Rooms of the prepared map are spawned hidden while the current map is played, not only its layout is solved */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Next map")
+	bool PrespawnNextMap = true;
+	/** Rooms of the prepared map wait this far away from where they are planned */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Next map", meta=(EditCondition="PrespawnNextMap"))
+	FVector NextMapStagingOffset{0, 0, -500000};
+	/** Smaller than SpawnBudgetMilliseconds, the current run keeps playing while the next map is spawned */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Next map", meta=(EditCondition="PrespawnNextMap", ClampMin="0.1"))
+	float PrespawnBudgetMilliseconds = 1.f;
+	/** StartGeneration builds an endless map out of independently solved chunks instead of one map of the container's size */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Chunked generation")
+	bool UseChunkedGeneration = false;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Chunked generation", meta=(EditCondition="UseChunkedGeneration", ClampMin="1"))
+	int32 RoomsPerChunk = 24;
+	/** Offset between two chunks, has to be larger than a chunk grows across PortalRoomPlacementOffset */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Chunked generation", meta=(EditCondition="UseChunkedGeneration"))
+	FVector ChunkStride{1000000, -1000000, 0};
+	/** Chunks after the player's chunk that are kept spawned */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Chunked generation", meta=(EditCondition="UseChunkedGeneration", ClampMin="1"))
+	int32 ChunksAhead = 1;
+	/** Chunks before the player's chunk that are kept spawned, older ones are released */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Chunked generation", meta=(EditCondition="UseChunkedGeneration", ClampMin="0"))
+	int32 ChunksBehind = 1;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Chunked generation", meta=(EditCondition="UseChunkedGeneration", ClampMin="0"))
+	float ChunkCheckInterval = 0.5f;
+	/** Keeps every timed scope of a generation for ExportGenerationTrace */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map generation")
+	bool RecordGenerationTrace = false;
+	/** Draws every merged navigation volume, they add up in chunked maps since each window change draws them again */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map generation")
+	bool DrawNavigationBounds = false;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map generation", meta=(ClampMin="0.1"))
+	float SpawnBudgetMilliseconds = 4.f;
+	/** Rooms, portals and doors of a destroyed map are kept deactivated and reused by the next one */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map generation")
+	bool UseActorPool = true;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map generation", meta=(EditCondition="UseActorPool", ClampMin="0"))
+	int32 MaxPooledActorsPerClass = 32;
+	/** DestroyMap hides the map at once and destroys the actors that don't go back to the pool over several frames */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map generation")
+	bool UseIncrementalTeardown = true;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map generation", meta=(EditCondition="UseIncrementalTeardown", ClampMin="0.1"))
+	float TeardownBudgetMilliseconds = 2.f;
+	/** Requests a garbage collection once the last queued actor is destroyed */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map generation", meta=(EditCondition="UseIncrementalTeardown"))
+	bool CollectGarbageAfterTeardown = true;
+	/** Room geometry baked from the room container, rooms never have to be spawned to read it */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Map generation")
+	URoomTemplateTable* RoomTemplateTable;
 	
 	UPROPERTY()
 	class URoomEntrancePoint* StartRoomEntrancePoint;
 private:
 	UPROPERTY()
 	unsigned int InitialSeed;
-	UPROPERTY()
-	unsigned int EvaluatedSeed;
+	/** Draws of GetContinuousRandomInRange, split off InitialSeed so they never shift the layout */
+	FMapRandomStream GeneratorRandom;
 	UPROPERTY()
 	FVector PortalRoomPlacementOffset{100000,100000,0};
-	UPROPERTY()
-	FVector PortalRoomPlacementCurrentPosition{0,0,0};
 	UPROPERTY(VisibleAnywhere , Category="Map generation")
 	TArray<ABattleRoom*> GeneratedBattleRooms;
 	UPROPERTY()
@@ -92,16 +431,94 @@ private:
 	ABossRoom* GeneratedBossRooms;
 	UPROPERTY()
 	AStartRoom* GeneratedStartRoom;
-};
 
-template <class T>
-TSubclassOf<T> AMapGenerator::PickRandomRoom(TArray<TSubclassOf<T>> RoomArray, bool RemovePickedRoomFromArray = false)
-{
-	int RandomIndex = GetContinuousRandomInRange(0, RoomArray.Num() - 1);
-	TSubclassOf<T> PickedRoom = RoomArray[RandomIndex];
-	if (RemovePickedRoomFromArray)
-	{
-		RoomArray.RemoveAt(RandomIndex);
-	}
-	return PickedRoom;
-}
\ No newline at end of file
+	UPROPERTY()
+	URoomTemplateTable* RuntimeRoomTemplateTable;
+
+	/** Plan that is being instantiated or was instantiated last and the rooms spawned for it */
+	FMapLayoutPlan ActivePlan;
+	TWeakObjectPtr<const UPCGRoomContainer> ActiveRoomContainer;
+	UPROPERTY()
+	TArray<ARoom*> SpawnedPlanRooms;
+	int32 NextPlannedRoomIndex = 0;
+	TFuture<FMapLayoutPlan> PendingLayout;
+	bool IsGenerationInProgress = false;
+
+	UPROPERTY()
+	TMap<UClass*, FMapActorPoolEntry> ActorPool;
+	UPROPERTY(VisibleAnywhere, Category="Map generation")
+	FMapActorPoolStats ActorPoolStats;
+	UPROPERTY(VisibleAnywhere, Category="Map generation")
+	FMapGenerationStats GenerationStats;
+
+	/** Hidden actors of destroyed maps waiting for TickTeardown */
+	UPROPERTY()
+	TArray<AActor*> PendingDestroyActors;
+	int32 TeardownFrameCount = 0;
+	int32 TeardownDestroyedCount = 0;
+
+	/** World bounds of the nav boxes of the rooms placed so far */
+	TArray<FBox> PendingNavBounds;
+	/** Minimap entries of the chunk room being instantiated */
+	TArray<FMapMinimapMarker> PendingMinimapMarkers;
+	int32 ActiveNavMeshVolumeCount = 0;
+	double NavMeshBuildStartSeconds = 0;
+	bool IsWaitingForNavMeshBuild = false;
+
+	UPROPERTY()
+	FMinimapAtlas MinimapAtlas;
+	FMinimapAtlasBuilder MinimapAtlasBuilder;
+	/** Minimap island of every planned room */
+	TArray<int32> MinimapIslands;
+	bool IsBuildingMinimapAtlas = false;
+
+	/** Every planned room, to find the rooms near the player */
+	FRoomSpatialGrid PlannedRoomGrid;
+	TArray<int32> PlannedRoomQueryResult;
+	FMapLayoutGraph RoomGraph;
+	TMap<const ARoom*, int32> PlannedRoomIndices;
+
+	/** Rooms whose entities are not spawned yet, indexed like ActivePlan.Rooms */
+	UPROPERTY()
+	TArray<ARoom*> DeferredSpawnRooms;
+	int32 DeferredSpawnCount = 0;
+	float DeferredSpawnCheckTimer = 0.f;
+	/** Rooms whose entities were spawned when the restored snapshot was saved, only set while it is instantiated */
+	TBitArray<> RestoredSpawnedRooms;
+
+	/** Indexed like ActivePlan.Rooms */
+	TBitArray<> DormantRooms;
+	/** Rooms around PlayerRoomIndex that are kept active */
+	TArray<int32> AwakeRooms;
+	/** Scratch of UpdateRoomDormancy, all false outside of it */
+	TBitArray<> NearRoomMask;
+	/** Spawner-owned actors of dormant rooms, woken together with their room */
+	TMap<int32, TArray<TWeakObjectPtr<AActor>>> DormantRoomActors;
+	/** Points whose placeholder mesh was spawned, ResetPooledActor only turns placeholders off */
+	TSet<TWeakObjectPtr<URoomConnectionPoint>> PointsWithPlaceholder;
+	int32 PlayerRoomIndex = INDEX_NONE;
+	float RoomDormancyCheckTimer = 0.f;
+	bool IsRoomDormancyActive = false;
+
+	/** Layout of the map after this one, solved while the current map is played */
+	TFuture<FMapLayoutPlan> PendingNextLayout;
+	FMapLayoutPlan NextMapPlan;
+	FMapGenerationParams NextMapParams;
+	TWeakObjectPtr<const UPCGRoomContainer> NextMapRoomContainer;
+	/** Hidden rooms of NextMapPlan, indexed like its rooms */
+	UPROPERTY()
+	TArray<ARoom*> NextMapRooms;
+	/** Rooms spawned ahead for ActivePlan while it is instantiated, taken by AcquirePlannedRoom */
+	UPROPERTY()
+	TArray<ARoom*> StagedPlanRooms;
+
+	/** Shared with the workers solving chunks */
+	TSharedPtr<const FMapChunkPlanner> ChunkPlanner;
+	/** Consecutive chunks around the player, ordered by chunk index */
+	UPROPERTY()
+	TArray<FMapChunkInstance> ActiveChunks;
+	TFuture<FMapLayoutChunk> PendingChunk;
+	int32 PlayerChunkIndex = 0;
+	float ChunkCheckTimer = 0.f;
+	bool IsChunkedMapActive = false;
+};
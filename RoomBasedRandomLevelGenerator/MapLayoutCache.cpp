@@ -0,0 +1,260 @@
+#include "../PCG/MapLayoutCache.h"
+
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace
+{
+	constexpr uint32 MapLayoutFileMagic = 0x4D4C5043; // "MLPC"
+
+	template <typename TEnum>
+	void SerializeEnum(FArchive& Ar, TEnum& Value)
+	{
+		uint8 Byte = static_cast<uint8>(Value);
+		Ar << Byte;
+		Value = static_cast<TEnum>(Byte);
+	}
+
+	/** Rooms never scale, so only location and rotation are stored */
+	void SerializeRoomTransform(FArchive& Ar, FTransform& Transform)
+	{
+		FVector Location = Transform.GetLocation();
+		FQuat Rotation = Transform.GetRotation();
+		Ar << Location << Rotation;
+		Transform = FTransform(Rotation, Location);
+	}
+
+	void SerializeRoom(FArchive& Ar, FMapLayoutRoom& Room)
+	{
+		SerializeEnum(Ar, Room.Kind);
+		Ar << Room.TemplateIndex;
+		SerializeRoomTransform(Ar, Room.Transform);
+		Ar << Room.WorldBounds;
+		Ar << Room.IsPlaced;
+		Ar << Room.ParentIndex;
+		Ar << Room.IsSideRoom;
+		SerializeEnum(Ar, Room.Connection);
+		Ar << Room.ParentPointIndex;
+		Ar << Room.IsParentPointPuzzlePoint;
+		SerializeEnum(Ar, Room.PortalSet);
+		Ar << Room.PortalIndex;
+		Ar << Room.SafeRoomIndex;
+		Ar << Room.SpawnSeed;
+		Ar << Room.AvailableExitPoints;
+		Ar << Room.AvailablePuzzlePoints;
+	}
+
+	void SerializeFootprint(FArchive& Ar, FRoomFootprint& Footprint)
+	{
+		Ar << Footprint.LocalBounds;
+		Ar << Footprint.EntrancePoint;
+		Ar << Footprint.ExitPoints;
+		Ar << Footprint.PuzzlePoints;
+		Ar << Footprint.HasNavBox;
+		Ar << Footprint.NavBoxTransform;
+		Ar << Footprint.NavBoxExtent;
+		Ar << Footprint.Weight;
+	}
+}
+
+FMapLayoutCache::FMapLayoutCache(const FString& InDirectory)
+	: Directory(InDirectory)
+{
+}
+
+FString FMapLayoutCache::MakeKey(const FMapLayoutSettings& Settings, const FMapLayoutTemplates& Templates, const FString& Salt)
+{
+	/** Hashing the serialized inputs keeps the key in sync with every field that reaches the solver */
+	TArray<uint8> KeyData;
+	FMemoryWriter Ar(KeyData);
+	int32 KeyVersion = Version;
+	Ar << KeyVersion;
+
+	FMapLayoutSettings KeySettings = Settings;
+	Ar << KeySettings.BattleRoomCount << KeySettings.SafeRoomFrequency << KeySettings.PuzzleRoomFrequency << KeySettings.Seed;
+	Ar << KeySettings.HasBossRoom << KeySettings.MakeBattleRoomsUnique << KeySettings.MakePuzzleRoomsUnique << KeySettings.MakeSafeRoomsUnique;
+	Ar << KeySettings.StartRoomLocation << KeySettings.PortalRoomPlacementOffset << KeySettings.PortalRoomPlacementOrigin << KeySettings.StartsWithBattleRoom;
+	Ar << KeySettings.OverlapTolerance << KeySettings.SpatialGridCellSize << KeySettings.StaticObstacles << KeySettings.SolveIslandsInParallel;
+	Ar << KeySettings.SearchDoorPlacement << KeySettings.DoorSearchBudget;
+
+	FMapLayoutTemplates KeyTemplates = Templates;
+	for (TArray<FRoomFootprint>* Rooms : {&KeyTemplates.StartRooms, &KeyTemplates.BattleRooms, &KeyTemplates.PuzzleRooms, &KeyTemplates.BossRooms})
+	{
+		int32 RoomCount = Rooms->Num();
+		Ar << RoomCount;
+		for (FRoomFootprint& Footprint : *Rooms)
+		{
+			SerializeFootprint(Ar, Footprint);
+		}
+	}
+	Ar << KeyTemplates.BattleRoomPortalCount << KeyTemplates.PuzzleRoomPortalCount << KeyTemplates.SafeRoomPortalCount << KeyTemplates.SafeRoomCount;
+
+	FString KeySalt = Salt;
+	Ar << KeySalt;
+
+	FSHAHash Hash;
+	FSHA1::HashBuffer(KeyData.GetData(), KeyData.Num(), Hash.Hash);
+	return Hash.ToString();
+}
+
+FString FMapLayoutCache::GetFilePath(const FString& Key) const
+{
+	return FPaths::Combine(Directory, Key + TEXT(".layout"));
+}
+
+bool FMapLayoutCache::SerializePlan(FArchive& Ar, FMapLayoutPlan& Plan)
+{
+	int32 PlanVersion = Version;
+	Ar << PlanVersion;
+	if (PlanVersion != Version)
+	{
+		return false;
+	}
+
+	Ar << Plan.Seed;
+	Ar << Plan.PortalFallbackCount;
+	Ar << Plan.AvoidedPortalCount;
+	Ar << Plan.PlacementAttempts;
+	Ar << Plan.OverlapTests;
+	Ar << Plan.NearMissQueries;
+	Ar << Plan.MissedPuzzleRoomCount;
+
+	int32 RoomCount = Plan.Rooms.Num();
+	Ar << RoomCount;
+	if (Ar.IsLoading())
+	{
+		if (RoomCount < 0 || RoomCount > Ar.TotalSize())
+		{
+			Ar.SetError();
+			return false;
+		}
+		Plan.Rooms.SetNum(RoomCount);
+	}
+	for (FMapLayoutRoom& Room : Plan.Rooms)
+	{
+		SerializeRoom(Ar, Room);
+	}
+	return !Ar.IsError();
+}
+
+bool FMapLayoutCache::IsPlanValid(const FMapLayoutPlan& Plan, const FMapLayoutTemplates& Templates)
+{
+	for (int32 RoomIndex = 0; RoomIndex < Plan.Rooms.Num(); RoomIndex++)
+	{
+		const FMapLayoutRoom& Room = Plan.Rooms[RoomIndex];
+		if (Room.Kind > EMapLayoutRoomKind::Boss || Room.Connection > EMapLayoutConnection::SafeRoomPortal || Room.PortalSet > EMapLayoutPortalSet::StartRoom)
+		{
+			return false;
+		}
+		const TArray<FRoomFootprint>& Footprints = Templates.GetRooms(Room.Kind);
+		if (!Footprints.IsValidIndex(Room.TemplateIndex))
+		{
+			return false;
+		}
+		const FRoomFootprint& Footprint = Footprints[Room.TemplateIndex];
+		for (const int32 ExitPointIndex : Room.AvailableExitPoints)
+		{
+			if (!Footprint.ExitPoints.IsValidIndex(ExitPointIndex))
+			{
+				return false;
+			}
+		}
+		for (const int32 PuzzlePointIndex : Room.AvailablePuzzlePoints)
+		{
+			if (!Footprint.PuzzlePoints.IsValidIndex(PuzzlePointIndex))
+			{
+				return false;
+			}
+		}
+		if (Room.SafeRoomIndex != INDEX_NONE && (Room.SafeRoomIndex < 0 || Room.SafeRoomIndex >= Templates.SafeRoomCount))
+		{
+			return false;
+		}
+
+		/** The generator connects rooms in plan order, a parent has to be spawned first */
+		if (Room.ParentIndex < INDEX_NONE || Room.ParentIndex >= RoomIndex)
+		{
+			return false;
+		}
+		if (Room.Connection == EMapLayoutConnection::None)
+		{
+			continue;
+		}
+		if (Room.ParentIndex == INDEX_NONE)
+		{
+			return false;
+		}
+		const FMapLayoutRoom& Parent = Plan.Rooms[Room.ParentIndex];
+		const FRoomFootprint& ParentFootprint = Templates.GetRooms(Parent.Kind)[Parent.TemplateIndex];
+		const TArray<FTransform>& ParentPoints = Room.IsParentPointPuzzlePoint ? ParentFootprint.PuzzlePoints : ParentFootprint.ExitPoints;
+		if (!ParentPoints.IsValidIndex(Room.ParentPointIndex))
+		{
+			return false;
+		}
+		if (Room.Connection == EMapLayoutConnection::Door)
+		{
+			continue;
+		}
+		int32 PortalCount = 1;
+		switch (Room.PortalSet)
+		{
+		case EMapLayoutPortalSet::Battle:
+			PortalCount = Templates.BattleRoomPortalCount;
+			break;
+		case EMapLayoutPortalSet::Puzzle:
+			PortalCount = Templates.PuzzleRoomPortalCount;
+			break;
+		case EMapLayoutPortalSet::SafeRoom:
+			PortalCount = Templates.SafeRoomPortalCount;
+			break;
+		default:
+			break;
+		}
+		if (Room.PortalIndex < 0 || Room.PortalIndex >= PortalCount)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FMapLayoutCache::Load(const FString& Key, const FMapLayoutTemplates& Templates, FMapLayoutPlan& OutPlan) const
+{
+	TArray<uint8> FileData;
+	if (!FFileHelper::LoadFileToArray(FileData, *GetFilePath(Key), FILEREAD_Silent))
+	{
+		return false;
+	}
+
+	FMemoryReader Ar(FileData);
+	uint32 Magic = 0;
+	Ar << Magic;
+	if (Magic != MapLayoutFileMagic)
+	{
+		return false;
+	}
+
+	FMapLayoutPlan Plan;
+	if (!SerializePlan(Ar, Plan) || Plan.IsEmpty() || !IsPlanValid(Plan, Templates))
+	{
+		return false;
+	}
+	OutPlan = MoveTemp(Plan);
+	return true;
+}
+
+bool FMapLayoutCache::Save(const FString& Key, const FMapLayoutPlan& Plan) const
+{
+	TArray<uint8> FileData;
+	FMemoryWriter Ar(FileData);
+	uint32 Magic = MapLayoutFileMagic;
+	Ar << Magic;
+	SerializePlan(Ar, const_cast<FMapLayoutPlan&>(Plan));
+
+	IFileManager::Get().MakeDirectory(*Directory, true);
+	return FFileHelper::SaveArrayToFile(FileData, *GetFilePath(Key));
+}
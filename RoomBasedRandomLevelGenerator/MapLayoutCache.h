@@ -0,0 +1,34 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MapLayoutSolver.h"
+
+/**
+ * Solved layouts stored as small versioned binary files, keyed by a hash of everything the solver result depends on.
+ * A cached plan is instantiated directly, without placement and overlap tests.
+ */
+class PVD_API FMapLayoutCache
+{
+public:
+	/** Bump whenever the plan format or the solver output for the same input changes */
+	static constexpr int32 Version = 3;
+
+	explicit FMapLayoutCache(const FString& InDirectory);
+
+	/** Salt carries what the solver can't see, e.g. the room classes behind the footprints or the level */
+	static FString MakeKey(const FMapLayoutSettings& Settings, const FMapLayoutTemplates& Templates, const FString& Salt);
+
+	/** A file that doesn't fit the templates, e.g. corrupt or from changed rooms under the same key, counts as a miss */
+	bool Load(const FString& Key, const FMapLayoutTemplates& Templates, FMapLayoutPlan& OutPlan) const;
+	bool Save(const FString& Key, const FMapLayoutPlan& Plan) const;
+
+	/** Plan without file header, false if the data is from another version or broken */
+	static bool SerializePlan(FArchive& Ar, FMapLayoutPlan& Plan);
+	/** Every index of the plan points into the templates and parents come before their children */
+	static bool IsPlanValid(const FMapLayoutPlan& Plan, const FMapLayoutTemplates& Templates);
+
+private:
+	FString GetFilePath(const FString& Key) const;
+
+	FString Directory;
+};
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "../PCG/MapLayoutCommandlet.h"
+
+#include "../PCG/RoomTemplateTable.h"
+#include "PVD/PVD.h"
+#include "PVD/Data/PCGRoomContainer.h"
+
+UMapLayoutCommandlet::UMapLayoutCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+bool UMapLayoutCommandlet::LoadLayoutInput(const FString& Params, FMapLayoutTemplates& OutTemplates, FMapLayoutSettings& OutSettings)
+{
+	FString ContainerPath;
+	if (!FParse::Value(*Params, TEXT("Container="), ContainerPath))
+	{
+		PVD_LOG(Error, TEXT("%s needs -Container=<room container asset path>"), *GetClass()->GetName());
+		return false;
+	}
+	UPCGRoomContainer* RoomContainer = LoadObject<UPCGRoomContainer>(nullptr, *ContainerPath);
+	if (RoomContainer == nullptr)
+	{
+		PVD_LOG(Error, TEXT("Room container %s could not be loaded"), *ContainerPath);
+		return false;
+	}
+
+	/** Room geometry is baked from class defaults, no world is needed */
+	TemplateTable = NewObject<URoomTemplateTable>(this);
+	TemplateTable->SourceContainer = RoomContainer;
+	TemplateTable->Rebuild();
+	int32 SafeRoomCount = 1;
+	FParse::Value(*Params, TEXT("SafeRooms="), SafeRoomCount);
+	OutTemplates = TemplateTable->MakeLayoutTemplates(SafeRoomCount);
+
+	OutSettings.BattleRoomCount = RoomContainer->MapSize;
+	OutSettings.SafeRoomFrequency = RoomContainer->SafeRoomFreq;
+	OutSettings.PuzzleRoomFrequency = RoomContainer->PuzzleRoomFreq;
+	OutSettings.HasBossRoom = RoomContainer->HasBossRoom;
+	OutSettings.MakeBattleRoomsUnique = RoomContainer->MakeBattleRoomsUnique;
+	OutSettings.MakePuzzleRoomsUnique = RoomContainer->MakePuzzleRoomsUnique;
+	OutSettings.MakeSafeRoomsUnique = RoomContainer->MakeSafeRoomsUnique;
+	FParse::Value(*Params, TEXT("BattleRooms="), OutSettings.BattleRoomCount);
+	FParse::Value(*Params, TEXT("SafeRoomFrequency="), OutSettings.SafeRoomFrequency);
+	FParse::Value(*Params, TEXT("PuzzleRoomFrequency="), OutSettings.PuzzleRoomFrequency);
+	OutSettings.HasBossRoom = (OutSettings.HasBossRoom || FParse::Param(*Params, TEXT("Boss"))) && !FParse::Param(*Params, TEXT("NoBoss"));
+	OutSettings.SolveIslandsInParallel = FParse::Param(*Params, TEXT("ParallelLayout"));
+	OutSettings.SearchDoorPlacement = !FParse::Param(*Params, TEXT("NoDoorSearch"));
+	FParse::Value(*Params, TEXT("DoorSearchBudget="), OutSettings.DoorSearchBudget);
+	return true;
+}
@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MapLayoutSolver.h"
+#include "Commandlets/Commandlet.h"
+#include "MapLayoutCommandlet.generated.h"
+
+class URoomTemplateTable;
+
+/**
+ * Base of the headless map tools. Reads -Container=<room container asset path> and bakes its room templates,
+ * map size, frequencies and flags come from the container unless -BattleRooms=, -SafeRoomFrequency=,
+ * -PuzzleRoomFrequency=, -SafeRooms= or -Boss/-NoBoss are given. -ParallelLayout solves the islands of the map on worker threads.
+ * -NoDoorSearch moves every room whose first door collides behind a portal, -DoorSearchBudget= limits the search otherwise.
+ */
+UCLASS(Abstract)
+class PVD_API UMapLayoutCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMapLayoutCommandlet();
+
+protected:
+	bool LoadLayoutInput(const FString& Params, FMapLayoutTemplates& OutTemplates, FMapLayoutSettings& OutSettings);
+
+	UPROPERTY()
+	URoomTemplateTable* TemplateTable;
+};
@@ -0,0 +1,199 @@
+#include "../PCG/MapLayoutGraph.h"
+
+#include "Algo/Reverse.h"
+
+void FMapLayoutGraph::Reset()
+{
+	Kinds.Reset();
+	Centers.Reset();
+	DistanceFromStart.Reset();
+	DistanceToEnd.Reset();
+	EdgeOffsets.Reset();
+	EdgeTargets.Reset();
+	EdgeConnections.Reset();
+	StartRoom = INDEX_NONE;
+	EndRoom = INDEX_NONE;
+}
+
+void FMapLayoutGraph::Build(const FMapLayoutPlan& Plan)
+{
+	Reset();
+	const int32 RoomCount = Plan.Rooms.Num();
+	Kinds.SetNumUninitialized(RoomCount);
+	Centers.SetNumUninitialized(RoomCount);
+	EdgeOffsets.SetNumZeroed(RoomCount + 1);
+
+	auto IsConnected = [&Plan](const FMapLayoutRoom& Room)
+	{
+		return Room.Connection != EMapLayoutConnection::None && Plan.Rooms.IsValidIndex(Room.ParentIndex);
+	};
+
+	/** Counting pass first, so the edges of a room end up next to each other */
+	bool HasBossRoom = false;
+	for (int32 RoomIndex = 0; RoomIndex < RoomCount; RoomIndex++)
+	{
+		const FMapLayoutRoom& Room = Plan.Rooms[RoomIndex];
+		Kinds[RoomIndex] = Room.Kind;
+		Centers[RoomIndex] = Room.WorldBounds.IsValid ? Room.WorldBounds.GetCenter() : Room.Transform.GetLocation();
+		if (IsConnected(Room))
+		{
+			EdgeOffsets[RoomIndex + 1]++;
+			EdgeOffsets[Room.ParentIndex + 1]++;
+		}
+
+		if (Room.Kind == EMapLayoutRoomKind::Start && StartRoom == INDEX_NONE)
+		{
+			StartRoom = RoomIndex;
+		}
+		if (Room.Kind == EMapLayoutRoomKind::Boss)
+		{
+			EndRoom = RoomIndex;
+			HasBossRoom = true;
+		}
+		else if (!HasBossRoom && !Room.IsSideRoom)
+		{
+			EndRoom = RoomIndex;
+		}
+	}
+	for (int32 RoomIndex = 0; RoomIndex < RoomCount; RoomIndex++)
+	{
+		EdgeOffsets[RoomIndex + 1] += EdgeOffsets[RoomIndex];
+	}
+
+	EdgeTargets.SetNumUninitialized(EdgeOffsets[RoomCount]);
+	EdgeConnections.SetNumUninitialized(EdgeOffsets[RoomCount]);
+	TArray<int32> EdgeCursors(EdgeOffsets.GetData(), RoomCount);
+	for (int32 RoomIndex = 0; RoomIndex < RoomCount; RoomIndex++)
+	{
+		const FMapLayoutRoom& Room = Plan.Rooms[RoomIndex];
+		if (!IsConnected(Room))
+		{
+			continue;
+		}
+		const int32 ToParent = EdgeCursors[RoomIndex]++;
+		EdgeTargets[ToParent] = Room.ParentIndex;
+		EdgeConnections[ToParent] = Room.Connection;
+		const int32 ToChild = EdgeCursors[Room.ParentIndex]++;
+		EdgeTargets[ToChild] = RoomIndex;
+		EdgeConnections[ToChild] = Room.Connection;
+	}
+
+	ComputeDistances(StartRoom, DistanceFromStart);
+	ComputeDistances(EndRoom, DistanceToEnd);
+}
+
+void FMapLayoutGraph::ComputeDistances(int32 SourceRoom, TArray<int32>& OutDistances) const
+{
+	OutDistances.Init(INDEX_NONE, Num());
+	if (!IsValidRoom(SourceRoom))
+	{
+		return;
+	}
+	TArray<int32> Queue;
+	Queue.Reserve(Num());
+	Queue.Add(SourceRoom);
+	OutDistances[SourceRoom] = 0;
+	for (int32 Cursor = 0; Cursor < Queue.Num(); Cursor++)
+	{
+		const int32 Room = Queue[Cursor];
+		for (const int32 Neighbour : GetNeighbours(Room))
+		{
+			if (OutDistances[Neighbour] == INDEX_NONE)
+			{
+				OutDistances[Neighbour] = OutDistances[Room] + 1;
+				Queue.Add(Neighbour);
+			}
+		}
+	}
+}
+
+void FMapLayoutGraph::GetRoomsWithinHops(int32 Room, int32 MaxHops, TArray<int32>& OutRooms) const
+{
+	OutRooms.Reset();
+	if (!IsValidRoom(Room))
+	{
+		return;
+	}
+	/** Only the neighbourhood is visited, the cost doesn't grow with the map */
+	TSet<int32> Visited;
+	OutRooms.Add(Room);
+	Visited.Add(Room);
+	int32 Cursor = 0;
+	for (int32 Hop = 0; Hop < MaxHops && Cursor < OutRooms.Num(); Hop++)
+	{
+		const int32 HopEnd = OutRooms.Num();
+		for (; Cursor < HopEnd; Cursor++)
+		{
+			for (const int32 Neighbour : GetNeighbours(OutRooms[Cursor]))
+			{
+				bool IsAlreadyVisited = false;
+				Visited.Add(Neighbour, &IsAlreadyVisited);
+				if (!IsAlreadyVisited)
+				{
+					OutRooms.Add(Neighbour);
+				}
+			}
+		}
+	}
+}
+
+bool FMapLayoutGraph::FindPath(int32 From, int32 To, TArray<int32>& OutPath) const
+{
+	OutPath.Reset();
+	if (!IsValidRoom(From) || !IsValidRoom(To))
+	{
+		return false;
+	}
+
+	/** Breadth first from From, stops as soon as To is reached */
+	TMap<int32, int32> PreviousRoom;
+	TArray<int32> Queue;
+	PreviousRoom.Add(From, INDEX_NONE);
+	Queue.Add(From);
+	for (int32 Cursor = 0; Cursor < Queue.Num() && !PreviousRoom.Contains(To); Cursor++)
+	{
+		for (const int32 Neighbour : GetNeighbours(Queue[Cursor]))
+		{
+			if (!PreviousRoom.Contains(Neighbour))
+			{
+				PreviousRoom.Add(Neighbour, Queue[Cursor]);
+				Queue.Add(Neighbour);
+			}
+		}
+	}
+	if (!PreviousRoom.Contains(To))
+	{
+		return false;
+	}
+
+	for (int32 Room = To; Room != INDEX_NONE; Room = PreviousRoom[Room])
+	{
+		OutPath.Add(Room);
+	}
+	Algo::Reverse(OutPath);
+	return true;
+}
+
+int32 FMapLayoutGraph::GetDistance(int32 From, int32 To) const
+{
+	if (!IsValidRoom(From) || !IsValidRoom(To))
+	{
+		return INDEX_NONE;
+	}
+	if (From == StartRoom || To == StartRoom)
+	{
+		return DistanceFromStart[From == StartRoom ? To : From];
+	}
+	if (From == EndRoom || To == EndRoom)
+	{
+		return DistanceToEnd[From == EndRoom ? To : From];
+	}
+	TArray<int32> Path;
+	return FindPath(From, To, Path) ? Path.Num() - 1 : INDEX_NONE;
+}
+
+SIZE_T FMapLayoutGraph::GetAllocatedSize() const
+{
+	return Kinds.GetAllocatedSize() + Centers.GetAllocatedSize() + DistanceFromStart.GetAllocatedSize() + DistanceToEnd.GetAllocatedSize()
+		+ EdgeOffsets.GetAllocatedSize() + EdgeTargets.GetAllocatedSize() + EdgeConnections.GetAllocatedSize();
+}
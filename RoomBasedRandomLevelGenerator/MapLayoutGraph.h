@@ -0,0 +1,59 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MapLayoutSolver.h"
+
+/**
+ * Connections of a solved layout as flat arrays. Room ids are the indices of FMapLayoutPlan::Rooms.
+ * Every connection is stored in both directions, so distance and neighbourhood queries never touch room actors.
+ */
+class PVD_API FMapLayoutGraph
+{
+public:
+	void Build(const FMapLayoutPlan& Plan);
+	void Reset();
+
+	FORCEINLINE int32 Num() const { return Kinds.Num(); }
+	FORCEINLINE bool IsValidRoom(int32 Room) const { return Kinds.IsValidIndex(Room); }
+	FORCEINLINE EMapLayoutRoomKind GetKind(int32 Room) const { return Kinds[Room]; }
+	FORCEINLINE const FVector& GetCenter(int32 Room) const { return Centers[Room]; }
+	FORCEINLINE TConstArrayView<int32> GetNeighbours(int32 Room) const
+	{
+		return TConstArrayView<int32>(EdgeTargets.GetData() + EdgeOffsets[Room], EdgeOffsets[Room + 1] - EdgeOffsets[Room]);
+	}
+	/** How each neighbour of GetNeighbours is reached, in the same order */
+	FORCEINLINE TConstArrayView<EMapLayoutConnection> GetConnections(int32 Room) const
+	{
+		return TConstArrayView<EMapLayoutConnection>(EdgeConnections.GetData() + EdgeOffsets[Room], EdgeOffsets[Room + 1] - EdgeOffsets[Room]);
+	}
+	/** Doors and portals between the start room and the room, INDEX_NONE when it isn't connected */
+	FORCEINLINE int32 GetDistanceFromStart(int32 Room) const { return DistanceFromStart[Room]; }
+	/** Doors and portals between the room and the end room */
+	FORCEINLINE int32 GetDistanceToEnd(int32 Room) const { return DistanceToEnd[Room]; }
+	FORCEINLINE int32 GetStartRoom() const { return StartRoom; }
+	/** Boss room, or the last main path room of maps without one */
+	FORCEINLINE int32 GetEndRoom() const { return EndRoom; }
+
+	/** Rooms at most MaxHops connections away ordered by distance, the room itself comes first */
+	void GetRoomsWithinHops(int32 Room, int32 MaxHops, TArray<int32>& OutRooms) const;
+	/** Rooms on the shortest way from From to To, both included. False when To can't be reached */
+	bool FindPath(int32 From, int32 To, TArray<int32>& OutPath) const;
+	/** Connections on the shortest way between the rooms, INDEX_NONE when To can't be reached */
+	int32 GetDistance(int32 From, int32 To) const;
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	void ComputeDistances(int32 SourceRoom, TArray<int32>& OutDistances) const;
+
+	TArray<EMapLayoutRoomKind> Kinds;
+	TArray<FVector> Centers;
+	TArray<int32> DistanceFromStart;
+	TArray<int32> DistanceToEnd;
+	/** Edges of room R are EdgeOffsets[R] up to EdgeOffsets[R + 1] */
+	TArray<int32> EdgeOffsets;
+	TArray<int32> EdgeTargets;
+	TArray<EMapLayoutConnection> EdgeConnections;
+	int32 StartRoom = INDEX_NONE;
+	int32 EndRoom = INDEX_NONE;
+};
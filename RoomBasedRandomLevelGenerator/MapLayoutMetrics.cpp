@@ -0,0 +1,91 @@
+#include "../PCG/MapLayoutMetrics.h"
+
+FMapLayoutMetrics FMapLayoutMetrics::Evaluate(const FMapLayoutPlan& Plan, const FMapLayoutSettings& Settings)
+{
+	FMapLayoutMetrics Metrics;
+	Metrics.Seed = Plan.Seed;
+	Metrics.RoomCount = Plan.Rooms.Num();
+	Metrics.PortalFallbackCount = Plan.PortalFallbackCount;
+
+	/** Parents always come before their children, so one pass is enough to group door connected rooms */
+	TArray<int32> GroupOfRoom;
+	TArray<FBox> GroupBounds;
+	GroupOfRoom.SetNumUninitialized(Plan.Rooms.Num());
+	int32 PlacedPuzzleRoomCount = 0;
+	bool HasBossRoom = false;
+	bool IsEveryRoomConnected = true;
+	for (int32 RoomIndex = 0; RoomIndex < Plan.Rooms.Num(); RoomIndex++)
+	{
+		const FMapLayoutRoom& Room = Plan.Rooms[RoomIndex];
+		const bool IsConnected = Room.Kind == EMapLayoutRoomKind::Start || Room.Connection != EMapLayoutConnection::None;
+		IsEveryRoomConnected &= IsConnected && Room.IsPlaced;
+
+		if (Room.Connection == EMapLayoutConnection::Door && Plan.Rooms.IsValidIndex(Room.ParentIndex))
+		{
+			GroupOfRoom[RoomIndex] = GroupOfRoom[Room.ParentIndex];
+			GroupBounds[GroupOfRoom[RoomIndex]] += Room.WorldBounds;
+		}
+		else
+		{
+			GroupOfRoom[RoomIndex] = GroupBounds.Add(Room.WorldBounds);
+		}
+
+		if (Room.Connection == EMapLayoutConnection::Portal || Room.Connection == EMapLayoutConnection::SafeRoomPortal)
+		{
+			Metrics.PortalCount++;
+		}
+		if (Room.Kind == EMapLayoutRoomKind::Puzzle && IsConnected)
+		{
+			PlacedPuzzleRoomCount++;
+		}
+		HasBossRoom |= Room.Kind == EMapLayoutRoomKind::Boss;
+
+		if (!Room.IsSideRoom)
+		{
+			Metrics.MainPathLength++;
+			if (Room.Connection == EMapLayoutConnection::Door && Plan.Rooms.IsValidIndex(Room.ParentIndex))
+			{
+				const FVector ParentCenter = Plan.Rooms[Room.ParentIndex].WorldBounds.GetCenter();
+				Metrics.MainPathDistance += FVector::Dist(ParentCenter, Room.WorldBounds.GetCenter()) / 100.0;
+			}
+		}
+	}
+
+	for (const FBox& Bounds : GroupBounds)
+	{
+		if (Bounds.IsValid)
+		{
+			const FVector Size = Bounds.GetSize();
+			Metrics.BoundingArea += Size.X * Size.Y / 10000.0;
+		}
+	}
+
+	const int32 PuzzleRoomWindowCount = PlacedPuzzleRoomCount + Plan.MissedPuzzleRoomCount;
+	if (PuzzleRoomWindowCount > 0)
+	{
+		Metrics.PuzzleRoomSuccess = static_cast<float>(PlacedPuzzleRoomCount) / PuzzleRoomWindowCount;
+	}
+	Metrics.IsComplete = !Plan.IsEmpty() && IsEveryRoomConnected && (!Settings.HasBossRoom || HasBossRoom);
+	return Metrics;
+}
+
+bool FMapLayoutMetrics::IsBetterThan(const FMapLayoutMetrics& Other) const
+{
+	if (IsComplete != Other.IsComplete)
+	{
+		return IsComplete;
+	}
+	if (PortalFallbackCount != Other.PortalFallbackCount)
+	{
+		return PortalFallbackCount < Other.PortalFallbackCount;
+	}
+	if (PuzzleRoomSuccess != Other.PuzzleRoomSuccess)
+	{
+		return PuzzleRoomSuccess > Other.PuzzleRoomSuccess;
+	}
+	if (BoundingArea != Other.BoundingArea)
+	{
+		return BoundingArea < Other.BoundingArea;
+	}
+	return Seed < Other.Seed;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MapLayoutSolver.h"
+
+/** Quality numbers of a solved layout, used to rank seeds offline */
+struct PVD_API FMapLayoutMetrics
+{
+	uint32 Seed = 0;
+	int32 RoomCount = 0;
+	int32 PortalFallbackCount = 0;
+	int32 PortalCount = 0;
+	/** Rooms on the way from the start room to the last room, side rooms excluded */
+	int32 MainPathLength = 0;
+	/** Walking distance between door connected main path rooms, in meters */
+	double MainPathDistance = 0;
+	/** XY area of every door connected group of rooms summed up, in square meters */
+	double BoundingArea = 0;
+	/** Placed puzzle rooms per puzzle room window, 1 when the map has none */
+	float PuzzleRoomSuccess = 1.f;
+	/** Every planned room has a connection and a requested boss room exists */
+	bool IsComplete = false;
+
+	static FMapLayoutMetrics Evaluate(const FMapLayoutPlan& Plan, const FMapLayoutSettings& Settings);
+
+	/** Complete maps first, then fewer portal fallbacks, more puzzle rooms and tighter maps */
+	bool IsBetterThan(const FMapLayoutMetrics& Other) const;
+};
@@ -0,0 +1,828 @@
+#include "../PCG/MapLayoutSolver.h"
+
+#include "Algo/BinarySearch.h"
+#include "Async/ParallelFor.h"
+#include "PVD/PVD.h"
+
+namespace
+{
+	/** Rooms only rotate around Z, so bounds are tested as oriented rectangles plus a height interval */
+	bool AreRoomBoundsOverlapping(const FBox& LocalA, const FTransform& TransformA, const FBox& LocalB, const FTransform& TransformB, float Tolerance)
+	{
+		const FVector ExtentA = LocalA.GetExtent() - FVector(Tolerance);
+		const FVector ExtentB = LocalB.GetExtent() - FVector(Tolerance);
+		if (ExtentA.GetMin() <= 0 || ExtentB.GetMin() <= 0)
+		{
+			return false;
+		}
+
+		const FVector CenterA = TransformA.TransformPosition(LocalA.GetCenter());
+		const FVector CenterB = TransformB.TransformPosition(LocalB.GetCenter());
+		if (FMath::Abs(CenterA.Z - CenterB.Z) >= ExtentA.Z + ExtentB.Z)
+		{
+			return false;
+		}
+
+		const FVector2D AxesA[2] = {FVector2D(TransformA.GetUnitAxis(EAxis::X)).GetSafeNormal(), FVector2D(TransformA.GetUnitAxis(EAxis::Y)).GetSafeNormal()};
+		const FVector2D AxesB[2] = {FVector2D(TransformB.GetUnitAxis(EAxis::X)).GetSafeNormal(), FVector2D(TransformB.GetUnitAxis(EAxis::Y)).GetSafeNormal()};
+		const FVector2D Delta(CenterB - CenterA);
+
+		for (const FVector2D& Axis : {AxesA[0], AxesA[1], AxesB[0], AxesB[1]})
+		{
+			const double ProjectionA = ExtentA.X * FMath::Abs(AxesA[0] | Axis) + ExtentA.Y * FMath::Abs(AxesA[1] | Axis);
+			const double ProjectionB = ExtentB.X * FMath::Abs(AxesB[0] | Axis) + ExtentB.Y * FMath::Abs(AxesB[1] | Axis);
+			if (FMath::Abs(Delta | Axis) >= ProjectionA + ProjectionB)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+const TArray<FRoomFootprint>& FMapLayoutTemplates::GetRooms(EMapLayoutRoomKind Kind) const
+{
+	switch (Kind)
+	{
+	case EMapLayoutRoomKind::Start:
+		return StartRooms;
+	case EMapLayoutRoomKind::Puzzle:
+		return PuzzleRooms;
+	case EMapLayoutRoomKind::Boss:
+		return BossRooms;
+	default:
+		return BattleRooms;
+	}
+}
+
+SIZE_T FMapLayoutPlan::GetAllocatedSize() const
+{
+	SIZE_T Size = Rooms.GetAllocatedSize();
+	for (const FMapLayoutRoom& Room : Rooms)
+	{
+		Size += Room.AvailableExitPoints.GetAllocatedSize() + Room.AvailablePuzzlePoints.GetAllocatedSize();
+	}
+	return Size;
+}
+
+void FMapLayoutSolver::FPlacementWorkspace::ResetIsland(float CellSize, bool InTestsStaticObstacles)
+{
+	RoomGrid.Reset(CellSize);
+	GridRooms.Reset();
+	TestsStaticObstacles = InTestsStaticObstacles;
+}
+
+SIZE_T FMapLayoutSolver::FPlacementWorkspace::GetAllocatedSize() const
+{
+	return RoomGrid.GetAllocatedSize() + GridRooms.GetAllocatedSize() + GridQueryResult.GetAllocatedSize();
+}
+
+SIZE_T FMapLayoutSolver::GetAllocatedSize() const
+{
+	SIZE_T Size = Plan.GetAllocatedSize() + Workspaces.GetAllocatedSize() + LayoutStreams.GetAllocatedSize() + PortalStreams.GetAllocatedSize()
+		+ SafeRoomSampler.GetAllocatedSize() + ForcedPortalRooms.GetAllocatedSize() + AfterSafeRooms.GetAllocatedSize() + IslandOfRoom.GetAllocatedSize()
+		+ RoomChildren.GetAllocatedSize() + RoomGridIds.GetAllocatedSize();
+	for (const TArray<int32, TInlineAllocator<2>>& Children : RoomChildren)
+	{
+		Size += Children.GetAllocatedSize();
+	}
+	for (const FPlacementWorkspace& Workspace : Workspaces)
+	{
+		Size += Workspace.GetAllocatedSize();
+	}
+	for (const FRoomSampler& Sampler : RoomSamplers)
+	{
+		Size += Sampler.GetAllocatedSize();
+	}
+	return Size;
+}
+
+FMapLayoutSolver::FMapLayoutSolver(const FMapLayoutTemplates& InTemplates, const FMapLayoutSettings& InSettings)
+	: Templates(InTemplates), Settings(InSettings)
+{
+}
+
+FTransform FMapLayoutSolver::GetWorldPoint(const FMapLayoutRoom& Room, const FTransform& LocalPoint)
+{
+	return LocalPoint * Room.Transform;
+}
+
+int32 FMapLayoutSolver::PickRandomTemplate(EMapLayoutRoomKind Kind, FMapRandomStream& Stream, bool RemovePickedRoomFromArray)
+{
+	FRoomSampler& Sampler = RoomSamplers[static_cast<int32>(Kind)];
+	return RemovePickedRoomFromArray ? Sampler.SampleAndRemove(Stream) : Sampler.Sample(Stream);
+}
+
+void FMapLayoutSolver::BuildSamplers()
+{
+	TArray<float> Weights;
+	for (const EMapLayoutRoomKind Kind : {EMapLayoutRoomKind::Start, EMapLayoutRoomKind::Battle, EMapLayoutRoomKind::Puzzle, EMapLayoutRoomKind::Boss})
+	{
+		Weights.Reset();
+		float TotalWeight = 0.f;
+		for (const FRoomFootprint& Footprint : Templates.GetRooms(Kind))
+		{
+			Weights.Add(Footprint.Weight);
+			TotalWeight += FMath::Max(Footprint.Weight, 0.f);
+		}
+		/** A kind whose rooms are all weighted zero would never give a room, every room of it gets the same chance instead */
+		if (!Weights.IsEmpty() && TotalWeight <= 0.f)
+		{
+			static const TCHAR* KindNames[] = {TEXT("start"), TEXT("battle"), TEXT("puzzle"), TEXT("boss")};
+			PVD_LOG(Warning, TEXT("Every %s room has a weight of zero, picking them uniformly"), KindNames[static_cast<int32>(Kind)]);
+			Weights.Init(1.f, Weights.Num());
+		}
+		RoomSamplers[static_cast<int32>(Kind)].Build(Weights);
+	}
+	Weights.Init(1.f, Templates.SafeRoomCount);
+	SafeRoomSampler.Build(Weights);
+}
+
+int32 FMapLayoutSolver::TakeRandomPoint(TArray<int32>& Points, FMapRandomStream& Stream)
+{
+	if (Points.IsEmpty())
+	{
+		return INDEX_NONE;
+	}
+	const int32 RandomIndex = Stream.RandRange(0, Points.Num() - 1);
+	const int32 Point = Points[RandomIndex];
+	Points.RemoveAt(RandomIndex);
+	return Point;
+}
+
+const FRoomFootprint& FMapLayoutSolver::GetFootprint(const FMapLayoutRoom& Room) const
+{
+	return Templates.GetRooms(Room.Kind)[Room.TemplateIndex];
+}
+
+int32 FMapLayoutSolver::AddRoom(EMapLayoutRoomKind Kind, int32 ParentIndex, bool IsSideRoom, bool RemovePickedRoomFromArray)
+{
+	const uint64 RoomKey = Plan.Rooms.Num();
+	FMapRandomStream& LayoutStream = LayoutStreams.Add_GetRef(RootRandom.Split(EMapRandomPurpose::Layout).Split(RoomKey));
+	PortalStreams.Add(RootRandom.Split(EMapRandomPurpose::Portal).Split(RoomKey));
+
+	FMapLayoutRoom Room;
+	Room.Kind = Kind;
+	Room.TemplateIndex = PickRandomTemplate(Kind, LayoutStream, RemovePickedRoomFromArray);
+	Room.ParentIndex = ParentIndex;
+	Room.IsSideRoom = IsSideRoom;
+	Room.SpawnSeed = RootRandom.Split(EMapRandomPurpose::Spawn).Split(RoomKey).NextUInt32();
+
+	ResetRoomPoints(Room);
+
+	RoomChildren.AddDefaulted();
+	RoomGridIds.Add(INDEX_NONE);
+	if (RoomChildren.IsValidIndex(ParentIndex))
+	{
+		RoomChildren[ParentIndex].Add(Plan.Rooms.Num());
+	}
+	return Plan.Rooms.Add(MoveTemp(Room));
+}
+
+void FMapLayoutSolver::ResetRoomPoints(FMapLayoutRoom& Room) const
+{
+	const FRoomFootprint& Footprint = GetFootprint(Room);
+	Room.AvailableExitPoints.Reset();
+	for (int32 PointIndex = 0; PointIndex < Footprint.ExitPoints.Num(); PointIndex++)
+	{
+		Room.AvailableExitPoints.Add(PointIndex);
+	}
+	Room.AvailablePuzzlePoints.Reset();
+	for (int32 PointIndex = 0; PointIndex < Footprint.PuzzlePoints.Num(); PointIndex++)
+	{
+		Room.AvailablePuzzlePoints.Add(PointIndex);
+	}
+}
+
+void FMapLayoutSolver::MarkPlaced(FPlacementWorkspace& Workspace, FMapLayoutRoom& Room)
+{
+	Room.WorldBounds = GetFootprint(Room).LocalBounds.TransformBy(Room.Transform);
+	Room.IsPlaced = true;
+	const int32 RoomIndex = static_cast<int32>(&Room - Plan.Rooms.GetData());
+	RoomGridIds[RoomIndex] = Workspace.GridRooms.Add(RoomIndex);
+	Workspace.RoomGrid.Insert(RoomGridIds[RoomIndex], Room.WorldBounds);
+}
+
+bool FMapLayoutSolver::IsOverlapping(FPlacementWorkspace& Workspace, const FMapLayoutRoom& Room, const FTransform& RoomTransform, int32 IgnoreRoomIndex)
+{
+	const FRoomFootprint& Footprint = GetFootprint(Room);
+	const FBox ShrunkBounds = Footprint.LocalBounds.TransformBy(RoomTransform).ExpandBy(-Settings.OverlapTolerance);
+
+	Workspace.RoomGrid.Query(ShrunkBounds, Workspace.GridQueryResult);
+	for (const int32 GridId : Workspace.GridQueryResult)
+	{
+		const int32 RoomIndex = Workspace.GridRooms[GridId];
+		if (RoomIndex == IgnoreRoomIndex)
+		{
+			continue;
+		}
+		const FMapLayoutRoom& PlacedRoom = Plan.Rooms[RoomIndex];
+		Workspace.OverlapTests++;
+		if (AreRoomBoundsOverlapping(Footprint.LocalBounds, RoomTransform, GetFootprint(PlacedRoom).LocalBounds, PlacedRoom.Transform, Settings.OverlapTolerance))
+		{
+			return true;
+		}
+	}
+
+	if (!Workspace.TestsStaticObstacles)
+	{
+		return false;
+	}
+	for (const FBox& Obstacle : Settings.StaticObstacles)
+	{
+		if (!ShrunkBounds.Intersect(Obstacle))
+		{
+			continue;
+		}
+		/** Physics can't be queried from worker threads */
+		if (!NearMissQuery || Settings.SolveIslandsInParallel)
+		{
+			return true;
+		}
+		Workspace.NearMissQueries++;
+		if (NearMissQuery(Footprint, RoomTransform))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void FMapLayoutSolver::PlaceRoom(int32 RoomIndex, bool ConnectWithPortal)
+{
+	if (IsLastRoomSafeRoom)
+	{
+		ConnectWithPortal = true;
+	}
+
+	FMapLayoutRoom& Room = Plan.Rooms[RoomIndex];
+	//if its a starter room
+	const bool IsStartRoom = Room.ParentIndex == INDEX_NONE;
+	if (IsStartRoom)
+	{
+		Room.Transform = FTransform(Settings.StartRoomLocation);
+		MapForward = GetWorldPoint(Room, GetFootprint(Room).EntrancePoint).GetRotation().GetForwardVector();
+	}
+
+	if (Settings.SolveIslandsInParallel)
+	{
+		ForcedPortalRooms.SetNum(RoomIndex + 1, false);
+		AfterSafeRooms.SetNum(RoomIndex + 1, false);
+		ForcedPortalRooms[RoomIndex] = ConnectWithPortal && !IsStartRoom;
+		AfterSafeRooms[RoomIndex] = IsLastRoomSafeRoom && !IsStartRoom;
+		return;
+	}
+
+	FPlacementWorkspace& Workspace = Workspaces[0];
+	if (IsStartRoom)
+	{
+		MarkPlaced(Workspace, Room);
+		return;
+	}
+	if (!ConnectWithPortal)
+	{
+		if (TryPlaceRoomWithDoor(Workspace, RoomIndex))
+		{
+			return;
+		}
+		Workspace.PortalFallbackCount++;
+	}
+	PortalRoomPlacementCurrentPosition += Settings.PortalRoomPlacementOffset;
+	PlaceRoomWithPortal(Workspace, RoomIndex, IsLastRoomSafeRoom, PortalRoomPlacementCurrentPosition);
+	if (IsLastRoomSafeRoom)
+	{
+		PickSafeRoom(RoomIndex);
+	}
+}
+
+bool FMapLayoutSolver::TryPlaceRoomWithDoor(FPlacementWorkspace& Workspace, int32 RoomIndex)
+{
+	/** The first exit point is the same draw as without the search, maps that never needed it stay the same */
+	int32 Budget = Settings.SearchDoorPlacement ? FMath::Max(Settings.DoorSearchBudget, 1) : 1;
+	int32 Attempts = 0;
+	if (TryExitPoints(Workspace, RoomIndex, Budget, Attempts))
+	{
+		Workspace.AvoidedPortalCount += Attempts > 1 ? 1 : 0;
+		return true;
+	}
+	if (Settings.SearchDoorPlacement && (TryOtherTemplates(Workspace, RoomIndex, Budget) || TryMoveParent(Workspace, RoomIndex, Budget)))
+	{
+		Workspace.AvoidedPortalCount++;
+		return true;
+	}
+	return false;
+}
+
+FTransform FMapLayoutSolver::GetDoorTransform(const FRoomFootprint& Footprint, const FTransform& ExitPoint)
+{
+	const FTransform& LocalEntrancePoint = Footprint.EntrancePoint;
+
+	//Rotation
+	FTransform RoomTransform = FTransform::Identity;
+	const FQuat EnterPointRotation = RoomTransform.GetRotation() * LocalEntrancePoint.GetRotation();
+	const FQuat QuatBetweenExitAndEnter = FQuat::FindBetweenNormals(ExitPoint.GetRotation().GetForwardVector(), EnterPointRotation.GetForwardVector());
+	float Angle = 0;
+	FVector Axis;
+
+	QuatBetweenExitAndEnter.ToAxisAndAngle(Axis, Angle);
+
+	Angle = FMath::RadiansToDegrees(Angle);
+
+	FRotator RoomRotation = RoomTransform.Rotator();
+	RoomRotation.Yaw -= Angle * Axis.Z;
+	RoomTransform.SetRotation(RoomRotation.Quaternion());
+
+	//Location
+	const FVector OffsetBetweenEnterAndExit = ExitPoint.GetLocation() - RoomTransform.TransformPosition(LocalEntrancePoint.GetLocation());
+	RoomTransform.AddToTranslation(OffsetBetweenEnterAndExit);
+	return RoomTransform;
+}
+
+void FMapLayoutSolver::GetCandidateExitPoints(const FMapLayoutRoom& RoomToConnect, TArray<int32>& OutExitPoints) const
+{
+	/**
+	 * Mirrors ARoom::GetRandomAvailableExitPoint(Generator, StartRoomEntranceRotation), which lives outside this module and
+	 * can't be called without a spawned room. Assumed rule: exits whose forward vector points back against the start room
+	 * entrance are skipped. The solver doesn't see that function, so a change to its filter has to be repeated here or
+	 * solved layouts stop matching the exits the old in-world generation would pick.
+	 */
+	const FRoomFootprint& Footprint = GetFootprint(RoomToConnect);
+	OutExitPoints.Reset();
+	for (const int32 ExitPointIndex : RoomToConnect.AvailableExitPoints)
+	{
+		const FTransform ExitPoint = GetWorldPoint(RoomToConnect, Footprint.ExitPoints[ExitPointIndex]);
+		if (FVector::DotProduct(ExitPoint.GetRotation().GetForwardVector(), MapForward) > -UE_KINDA_SMALL_NUMBER)
+		{
+			OutExitPoints.Add(ExitPointIndex);
+		}
+	}
+}
+
+bool FMapLayoutSolver::TryExitPoints(FPlacementWorkspace& Workspace, int32 RoomIndex, int32& Budget, int32& OutAttempts)
+{
+	FMapLayoutRoom& Room = Plan.Rooms[RoomIndex];
+	FMapLayoutRoom& RoomToConnect = Plan.Rooms[Room.ParentIndex];
+	const FRoomFootprint& ParentFootprint = GetFootprint(RoomToConnect);
+
+	TArray<int32> CandidateExitPoints;
+	GetCandidateExitPoints(RoomToConnect, CandidateExitPoints);
+	OutAttempts = 0;
+	while (Budget > 0)
+	{
+		const int32 ExitPointIndex = TakeRandomPoint(CandidateExitPoints, LayoutStreams[RoomIndex]);
+		if (ExitPointIndex == INDEX_NONE)
+		{
+			return false;
+		}
+		Budget--;
+		OutAttempts++;
+		Workspace.PlacementAttempts++;
+
+		const FTransform RoomTransform = GetDoorTransform(GetFootprint(Room), GetWorldPoint(RoomToConnect, ParentFootprint.ExitPoints[ExitPointIndex]));
+		if (IsOverlapping(Workspace, Room, RoomTransform, RoomIndex))
+		{
+			continue;
+		}
+
+		RoomToConnect.AvailableExitPoints.Remove(ExitPointIndex);
+		Room.Transform = RoomTransform;
+		Room.Connection = EMapLayoutConnection::Door;
+		Room.ParentPointIndex = ExitPointIndex;
+		Room.IsParentPointPuzzlePoint = false;
+		MarkPlaced(Workspace, Room);
+		return true;
+	}
+	return false;
+}
+
+bool FMapLayoutSolver::TryOtherTemplates(FPlacementWorkspace& Workspace, int32 RoomIndex, int32& Budget)
+{
+	FMapLayoutRoom& Room = Plan.Rooms[RoomIndex];
+	/** Unique picks already left their sampler, and a parallel solve decided the side rooms on the first pick */
+	const bool IsUnique = (Room.Kind == EMapLayoutRoomKind::Battle && Settings.MakeBattleRoomsUnique)
+		|| (Room.Kind == EMapLayoutRoomKind::Puzzle && Settings.MakePuzzleRoomsUnique);
+	const TArray<FRoomFootprint>& Footprints = Templates.GetRooms(Room.Kind);
+	if (IsUnique || Settings.SolveIslandsInParallel || Footprints.Num() < 2)
+	{
+		return false;
+	}
+
+	const int32 OriginalTemplateIndex = Room.TemplateIndex;
+	const int32 OtherCount = Footprints.Num() - 1;
+	const int32 FirstOther = LayoutStreams[RoomIndex].RandRange(0, OtherCount - 1);
+	for (int32 Other = 0; Other < OtherCount && Budget > 0; Other++)
+	{
+		const int32 TemplateIndex = (OriginalTemplateIndex + 1 + (FirstOther + Other) % OtherCount) % Footprints.Num();
+		if (Footprints[TemplateIndex].Weight <= 0.f)
+		{
+			continue;
+		}
+		Room.TemplateIndex = TemplateIndex;
+		ResetRoomPoints(Room);
+		int32 Attempts = 0;
+		if (TryExitPoints(Workspace, RoomIndex, Budget, Attempts))
+		{
+			return true;
+		}
+	}
+	Room.TemplateIndex = OriginalTemplateIndex;
+	ResetRoomPoints(Room);
+	return false;
+}
+
+bool FMapLayoutSolver::TryMoveParent(FPlacementWorkspace& Workspace, int32 RoomIndex, int32& Budget)
+{
+	const int32 ParentIndex = Plan.Rooms[RoomIndex].ParentIndex;
+	FMapLayoutRoom& Parent = Plan.Rooms[ParentIndex];
+	/** Only door connected parents without other placed children move, nothing else hangs on where they are */
+	if (Parent.Connection != EMapLayoutConnection::Door || !Plan.Rooms.IsValidIndex(Parent.ParentIndex))
+	{
+		return false;
+	}
+	for (const int32 OtherIndex : RoomChildren[ParentIndex])
+	{
+		if (OtherIndex == RoomIndex)
+		{
+			continue;
+		}
+		/** Forced portal rooms belong to other segments, their state is never read from this one */
+		if ((Settings.SolveIslandsInParallel && ForcedPortalRooms[OtherIndex]) || Plan.Rooms[OtherIndex].IsPlaced)
+		{
+			return false;
+		}
+	}
+	FMapLayoutRoom& GrandParent = Plan.Rooms[Parent.ParentIndex];
+	const FRoomFootprint& GrandParentFootprint = GetFootprint(GrandParent);
+	const int32 OriginalExitPointIndex = Parent.ParentPointIndex;
+	const FTransform OriginalTransform = Parent.Transform;
+
+	/** Available points stay sorted, so giving one back restores the exact order later draws see */
+	auto GiveBackExitPoint = [&GrandParent](int32 ExitPointIndex)
+	{
+		GrandParent.AvailableExitPoints.Insert(ExitPointIndex, Algo::LowerBound(GrandParent.AvailableExitPoints, ExitPointIndex));
+	};
+	RemoveFromGrid(Workspace, ParentIndex);
+	GiveBackExitPoint(OriginalExitPointIndex);
+
+	TArray<int32> CandidateExitPoints;
+	GetCandidateExitPoints(GrandParent, CandidateExitPoints);
+	CandidateExitPoints.Remove(OriginalExitPointIndex);
+	while (Budget > 0)
+	{
+		const int32 ExitPointIndex = TakeRandomPoint(CandidateExitPoints, LayoutStreams[RoomIndex]);
+		if (ExitPointIndex == INDEX_NONE)
+		{
+			break;
+		}
+		Budget--;
+		Workspace.PlacementAttempts++;
+		const FTransform ParentTransform = GetDoorTransform(GetFootprint(Parent), GetWorldPoint(GrandParent, GrandParentFootprint.ExitPoints[ExitPointIndex]));
+		if (IsOverlapping(Workspace, Parent, ParentTransform, ParentIndex))
+		{
+			continue;
+		}
+
+		GrandParent.AvailableExitPoints.Remove(ExitPointIndex);
+		Parent.Transform = ParentTransform;
+		Parent.ParentPointIndex = ExitPointIndex;
+		MarkPlaced(Workspace, Parent);
+		int32 Attempts = 0;
+		if (TryExitPoints(Workspace, RoomIndex, Budget, Attempts))
+		{
+			return true;
+		}
+		RemoveFromGrid(Workspace, ParentIndex);
+		GiveBackExitPoint(ExitPointIndex);
+	}
+
+	GrandParent.AvailableExitPoints.Remove(OriginalExitPointIndex);
+	Parent.Transform = OriginalTransform;
+	Parent.ParentPointIndex = OriginalExitPointIndex;
+	MarkPlaced(Workspace, Parent);
+	return false;
+}
+
+void FMapLayoutSolver::RemoveFromGrid(FPlacementWorkspace& Workspace, int32 RoomIndex)
+{
+	/** The id is only trusted while the workspace still maps it back to the room, a reset island has handed it out again */
+	const int32 GridId = RoomGridIds[RoomIndex];
+	if (Workspace.GridRooms.IsValidIndex(GridId) && Workspace.GridRooms[GridId] == RoomIndex)
+	{
+		Workspace.RoomGrid.Remove(GridId);
+		Workspace.GridRooms[GridId] = INDEX_NONE;
+	}
+	RoomGridIds[RoomIndex] = INDEX_NONE;
+}
+
+//this is for puzzle rooms and normal rooms that collide
+void FMapLayoutSolver::PlaceRoomWithPortal(FPlacementWorkspace& Workspace, int32 RoomIndex, bool IsAfterSafeRoom, const FVector& Location)
+{
+	FMapLayoutRoom& Room = Plan.Rooms[RoomIndex];
+	FMapLayoutRoom& RoomToConnect = Plan.Rooms[Room.ParentIndex];
+	FMapRandomStream& PortalStream = PortalStreams[RoomIndex];
+
+	Room.Transform = FTransform(Location);
+	MarkPlaced(Workspace, Room);
+
+	int32 PointIndex = INDEX_NONE;
+	if (Room.Kind == EMapLayoutRoomKind::Puzzle)
+	{
+		PointIndex = TakeRandomPoint(RoomToConnect.AvailablePuzzlePoints, PortalStream);
+		Room.IsParentPointPuzzlePoint = PointIndex != INDEX_NONE;
+		Room.PortalSet = EMapLayoutPortalSet::Puzzle;
+		Room.PortalIndex = PortalStream.RandRange(0, Templates.PuzzleRoomPortalCount - 1);
+	}
+	if (PointIndex == INDEX_NONE)
+	{
+		PointIndex = TakeRandomPoint(RoomToConnect.AvailableExitPoints, PortalStream);
+		Room.PortalSet = EMapLayoutPortalSet::Battle;
+		Room.PortalIndex = PortalStream.RandRange(0, Templates.BattleRoomPortalCount - 1);
+	}
+	Room.Connection = EMapLayoutConnection::Portal;
+	if (IsAfterSafeRoom)
+	{
+		Room.PortalSet = EMapLayoutPortalSet::SafeRoom;
+		Room.PortalIndex = PortalStream.RandRange(0, Templates.SafeRoomPortalCount - 1);
+		Room.Connection = EMapLayoutConnection::SafeRoomPortal;
+	}
+	/** An empty portal set falls back to the start room portal, same as the chunk stitch and the door fallback of the generator */
+	const int32 PortalCount = Room.PortalSet == EMapLayoutPortalSet::Puzzle ? Templates.PuzzleRoomPortalCount
+		: Room.PortalSet == EMapLayoutPortalSet::SafeRoom ? Templates.SafeRoomPortalCount
+		: Templates.BattleRoomPortalCount;
+	if (RoomToConnect.Kind == EMapLayoutRoomKind::Start || PortalCount <= 0)
+	{
+		Room.PortalSet = EMapLayoutPortalSet::StartRoom;
+		Room.PortalIndex = 0;
+	}
+	if (PointIndex == INDEX_NONE)
+	{
+		Room.Connection = EMapLayoutConnection::None;
+		return;
+	}
+	Room.ParentPointIndex = PointIndex;
+}
+
+void FMapLayoutSolver::PickSafeRoom(int32 RoomIndex)
+{
+	FMapRandomStream& PortalStream = PortalStreams[RoomIndex];
+	Plan.Rooms[RoomIndex].SafeRoomIndex = Settings.MakeSafeRoomsUnique ? SafeRoomSampler.SampleAndRemove(PortalStream) : SafeRoomSampler.Sample(PortalStream);
+}
+
+void FMapLayoutSolver::SolveIslands()
+{
+	const int32 RoomCount = Plan.Rooms.Num();
+	ForcedPortalRooms.SetNum(RoomCount, false);
+	AfterSafeRooms.SetNum(RoomCount, false);
+
+	/** Rooms behind a forced portal start a segment, every other room tries a door in the segment of its parent */
+	TArray<TArray<int32>> Segments;
+	TArray<int32> SegmentOfRoom;
+	SegmentOfRoom.SetNumUninitialized(RoomCount);
+	for (int32 RoomIndex = 0; RoomIndex < RoomCount; RoomIndex++)
+	{
+		const int32 ParentIndex = Plan.Rooms[RoomIndex].ParentIndex;
+		const bool IsSegmentStart = ParentIndex == INDEX_NONE || ForcedPortalRooms[RoomIndex];
+		SegmentOfRoom[RoomIndex] = IsSegmentStart ? Segments.AddDefaulted() : SegmentOfRoom[ParentIndex];
+		Segments[SegmentOfRoom[RoomIndex]].Add(RoomIndex);
+	}
+
+	/**
+	 * A segment only writes its own rooms and the parent points its first room connects to, which no other segment uses.
+	 * Segments are dealt out round robin, so the worker count changes who solves a segment but never its result.
+	 */
+	IslandOfRoom.SetNumUninitialized(RoomCount);
+	const int32 AvailableWorkerCount = MaxWorkerCount > 0 ? MaxWorkerCount : FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+	const int32 WorkerCount = FMath::Clamp(AvailableWorkerCount, 1, FMath::Max(Segments.Num(), 1));
+	Workspaces.SetNum(WorkerCount);
+	ParallelFor(WorkerCount, [this, &Segments, WorkerCount](int32 Worker)
+	{
+		FPlacementWorkspace& Workspace = Workspaces[Worker];
+		for (int32 Segment = Worker; Segment < Segments.Num(); Segment += WorkerCount)
+		{
+			SolveSegment(Workspace, Segments[Segment]);
+		}
+	}, WorkerCount == 1 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+	PlaceIslands();
+	for (TConstSetBitIterator<> It(AfterSafeRooms); It; ++It)
+	{
+		PickSafeRoom(It.GetIndex());
+	}
+}
+
+void FMapLayoutSolver::SolveSegment(FPlacementWorkspace& Workspace, TConstArrayView<int32> SegmentRooms)
+{
+	int32 Island = INDEX_NONE;
+	for (const int32 RoomIndex : SegmentRooms)
+	{
+		FMapLayoutRoom& Room = Plan.Rooms[RoomIndex];
+		if (Room.ParentIndex == INDEX_NONE)
+		{
+			/** The start room island stays where the level expects it */
+			Workspace.ResetIsland(Settings.SpatialGridCellSize, true);
+			MarkPlaced(Workspace, Room);
+			Island = RoomIndex;
+		}
+		else if (ForcedPortalRooms[RoomIndex] || !TryPlaceRoomWithDoor(Workspace, RoomIndex))
+		{
+			if (!ForcedPortalRooms[RoomIndex])
+			{
+				Workspace.PortalFallbackCount++;
+			}
+			/** New island around the local origin, the rooms before it are never tested again */
+			Workspace.ResetIsland(Settings.SpatialGridCellSize, false);
+			PlaceRoomWithPortal(Workspace, RoomIndex, AfterSafeRooms[RoomIndex], FVector::ZeroVector);
+			Island = RoomIndex;
+		}
+		IslandOfRoom[RoomIndex] = Island;
+	}
+}
+
+void FMapLayoutSolver::PlaceIslands()
+{
+	const int32 RoomCount = Plan.Rooms.Num();
+	TArray<int32> IslandRoots;
+	TArray<FBox> IslandBounds;
+	TArray<int32> IslandSlotOfRoom;
+	IslandSlotOfRoom.SetNumUninitialized(RoomCount);
+	for (int32 RoomIndex = 0; RoomIndex < RoomCount; RoomIndex++)
+	{
+		const int32 Root = IslandOfRoom[RoomIndex];
+		if (Root == RoomIndex)
+		{
+			IslandSlotOfRoom[RoomIndex] = IslandRoots.Add(RoomIndex);
+			IslandBounds.Add(FBox(ForceInit));
+		}
+		else
+		{
+			IslandSlotOfRoom[RoomIndex] = IslandSlotOfRoom[Root];
+		}
+		IslandBounds[IslandSlotOfRoom[RoomIndex]] += Plan.Rooms[RoomIndex].WorldBounds;
+	}
+
+	/** Same walk along PortalRoomPlacementOffset as the sequential solve, steps that would touch earlier islands or level geometry are skipped */
+	const FVector Step = Settings.PortalRoomPlacementOffset;
+	FRoomSpatialGrid PlacedIslands(FMath::Max(Step.Size2D(), Settings.SpatialGridCellSize));
+	TArray<int32> QueryResult;
+	auto IsBlocked = [this, &PlacedIslands, &QueryResult](const FBox& Bounds)
+	{
+		PlacedIslands.Query(Bounds, QueryResult);
+		if (!QueryResult.IsEmpty())
+		{
+			return true;
+		}
+		for (const FBox& Obstacle : Settings.StaticObstacles)
+		{
+			if (Bounds.Intersect(Obstacle))
+			{
+				return true;
+			}
+		}
+		return false;
+	};
+
+	TArray<FVector> IslandOffsets;
+	IslandOffsets.SetNumZeroed(IslandRoots.Num());
+	FVector Position = FVector::ZeroVector;
+	for (int32 Slot = 0; Slot < IslandRoots.Num(); Slot++)
+	{
+		if (Plan.Rooms[IslandRoots[Slot]].ParentIndex != INDEX_NONE)
+		{
+			do
+			{
+				Position += Step;
+			}
+			while (IsBlocked(IslandBounds[Slot].ShiftBy(Settings.PortalRoomPlacementOrigin + Position)) && !Step.IsNearlyZero());
+			IslandOffsets[Slot] = Settings.PortalRoomPlacementOrigin + Position;
+		}
+		PlacedIslands.Insert(Slot, IslandBounds[Slot].ShiftBy(IslandOffsets[Slot]));
+	}
+
+	for (int32 RoomIndex = 0; RoomIndex < RoomCount; RoomIndex++)
+	{
+		const FVector& Offset = IslandOffsets[IslandSlotOfRoom[RoomIndex]];
+		FMapLayoutRoom& Room = Plan.Rooms[RoomIndex];
+		Room.Transform.AddToTranslation(Offset);
+		Room.WorldBounds = Room.WorldBounds.ShiftBy(Offset);
+	}
+}
+
+void FMapLayoutSolver::PlaceBossRoom(int32& LastRoomIndex)
+{
+	if (Templates.BossRooms.IsEmpty())
+	{
+		return;
+	}
+	const int32 BossRoomIndex = AddRoom(EMapLayoutRoomKind::Boss, LastRoomIndex);
+	PlaceRoom(BossRoomIndex);
+	LastRoomIndex = BossRoomIndex;
+}
+
+FMapLayoutPlan FMapLayoutSolver::Solve()
+{
+	Plan = FMapLayoutPlan();
+	Plan.Seed = Settings.Seed;
+	RootRandom = FMapRandomStream(Settings.Seed);
+	LayoutStreams.Reset();
+	PortalStreams.Reset();
+	PortalRoomPlacementCurrentPosition = Settings.PortalRoomPlacementOrigin;
+	IsLastRoomSafeRoom = false;
+	ForcedPortalRooms.Empty();
+	AfterSafeRooms.Empty();
+	IslandOfRoom.Reset();
+	RoomChildren.Reset();
+	RoomGridIds.Reset();
+	Workspaces.SetNum(1);
+	Workspaces[0] = FPlacementWorkspace();
+	Workspaces[0].ResetIsland(Settings.SpatialGridCellSize, true);
+	BuildSamplers();
+
+	if (Templates.StartRooms.IsEmpty() || Templates.BattleRooms.IsEmpty())
+	{
+		return Plan;
+	}
+
+	const bool HasSafeRoom = Settings.SafeRoomFrequency > 0;
+	const bool HasPuzzleRoom = Settings.PuzzleRoomFrequency > 0 && !Templates.PuzzleRooms.IsEmpty();
+
+	int32 LinearRoomCount = Settings.BattleRoomCount;
+	if (HasSafeRoom)
+	{
+		LinearRoomCount += Settings.BattleRoomCount / Settings.SafeRoomFrequency;
+	}
+
+	const int32 StartRoomIndex = Settings.StartsWithBattleRoom
+		? AddRoom(EMapLayoutRoomKind::Battle, INDEX_NONE, false, Settings.MakeBattleRoomsUnique)
+		: AddRoom(EMapLayoutRoomKind::Start, INDEX_NONE, false, Settings.MakeSafeRoomsUnique);
+	PlaceRoom(StartRoomIndex);
+	int32 LastRoomIndex = StartRoomIndex;
+
+	if (LinearRoomCount == 0)
+	{
+		PlaceBossRoom(LastRoomIndex);
+		return FinishSolve();
+	}
+
+	int32 SpawnedBattleRoomCount = 0;
+	bool SpawnedPuzzleRoom = false;
+
+	for (int32 Index = 1; Index <= LinearRoomCount; Index++)
+	{
+		if (HasSafeRoom && !IsLastRoomSafeRoom && SpawnedBattleRoomCount % Settings.SafeRoomFrequency == 0 && SpawnedBattleRoomCount != 0)
+		{
+			IsLastRoomSafeRoom = true;
+		}
+		else
+		{
+			const int32 BattleRoomIndex = AddRoom(EMapLayoutRoomKind::Battle, LastRoomIndex, false, Settings.MakeBattleRoomsUnique);
+			SpawnedBattleRoomCount++;
+			PlaceRoom(BattleRoomIndex);
+			LastRoomIndex = BattleRoomIndex;
+			IsLastRoomSafeRoom = false;
+
+			if (HasPuzzleRoom)
+			{
+				if (SpawnedBattleRoomCount % Settings.PuzzleRoomFrequency == 0)
+				{
+					Plan.MissedPuzzleRoomCount += SpawnedPuzzleRoom ? 0 : 1;
+					SpawnedPuzzleRoom = false;
+				}
+				//Try to spawn a puzzle room if it has not spawned in frequency
+				if (!SpawnedPuzzleRoom && !Plan.Rooms[BattleRoomIndex].AvailablePuzzlePoints.IsEmpty())
+				{
+					const int32 PuzzleRoomIndex = AddRoom(EMapLayoutRoomKind::Puzzle, BattleRoomIndex, true, Settings.MakePuzzleRoomsUnique);
+					PlaceRoom(PuzzleRoomIndex, true);
+					SpawnedPuzzleRoom = true;
+				}
+			}
+		}
+
+		if (Settings.HasBossRoom && Index == LinearRoomCount)
+		{
+			PlaceBossRoom(LastRoomIndex);
+		}
+	}
+	if (HasPuzzleRoom && !SpawnedPuzzleRoom)
+	{
+		Plan.MissedPuzzleRoomCount++;
+	}
+
+	return FinishSolve();
+}
+
+FMapLayoutPlan FMapLayoutSolver::FinishSolve()
+{
+	if (Settings.SolveIslandsInParallel)
+	{
+		SolveIslands();
+	}
+	for (const FPlacementWorkspace& Workspace : Workspaces)
+	{
+		Plan.PlacementAttempts += Workspace.PlacementAttempts;
+		Plan.OverlapTests += Workspace.OverlapTests;
+		Plan.NearMissQueries += Workspace.NearMissQueries;
+		Plan.PortalFallbackCount += Workspace.PortalFallbackCount;
+		Plan.AvoidedPortalCount += Workspace.AvoidedPortalCount;
+	}
+	return MoveTemp(Plan);
+}
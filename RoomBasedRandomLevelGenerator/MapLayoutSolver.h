@@ -0,0 +1,259 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MapRandomStream.h"
+#include "RoomSampler.h"
+#include "RoomSpatialGrid.h"
+
+/** Decides which room class list a planned room's TemplateIndex points into */
+enum class EMapLayoutRoomKind : uint8
+{
+	Start,
+	Battle,
+	Puzzle,
+	Boss
+};
+
+/** How a planned room is reached from its parent room */
+enum class EMapLayoutConnection : uint8
+{
+	None,
+	Door,
+	Portal,
+	SafeRoomPortal
+};
+
+/** Portal class list of UPCGRoomContainer used by a portal connection */
+enum class EMapLayoutPortalSet : uint8
+{
+	Battle,
+	Puzzle,
+	SafeRoom,
+	StartRoom
+};
+
+/** Room geometry relative to the room's root. Everything the solver needs to know about a room class */
+struct FRoomFootprint
+{
+	FBox LocalBounds{ForceInit};
+	FTransform EntrancePoint;
+	TArray<FTransform> ExitPoints;
+	TArray<FTransform> PuzzlePoints;
+	bool HasNavBox = false;
+	FTransform NavBoxTransform;
+	FVector NavBoxExtent = FVector::ZeroVector;
+	/** Relative chance of the room class to be picked */
+	float Weight = 1.f;
+};
+
+/** Footprints in the same order as the class arrays of UPCGRoomContainer */
+struct FMapLayoutTemplates
+{
+	TArray<FRoomFootprint> StartRooms;
+	TArray<FRoomFootprint> BattleRooms;
+	TArray<FRoomFootprint> PuzzleRooms;
+	TArray<FRoomFootprint> BossRooms;
+	int32 BattleRoomPortalCount = 0;
+	int32 PuzzleRoomPortalCount = 0;
+	int32 SafeRoomPortalCount = 0;
+	int32 SafeRoomCount = 0;
+
+	const TArray<FRoomFootprint>& GetRooms(EMapLayoutRoomKind Kind) const;
+};
+
+struct FMapLayoutSettings
+{
+	int32 BattleRoomCount = 0;
+	int32 SafeRoomFrequency = 0;
+	int32 PuzzleRoomFrequency = 0;
+	uint32 Seed = 0;
+	bool HasBossRoom = false;
+	bool MakeBattleRoomsUnique = false;
+	bool MakePuzzleRoomsUnique = false;
+	bool MakeSafeRoomsUnique = false;
+	FVector StartRoomLocation{10000, 10000, 10000};
+	FVector PortalRoomPlacementOffset{100000, 100000, 0};
+	/** Rooms behind portals are placed in steps of PortalRoomPlacementOffset starting here */
+	FVector PortalRoomPlacementOrigin = FVector::ZeroVector;
+	/** First room is a battle room that is reached from outside the plan, e.g. from the chunk before, instead of the start room */
+	bool StartsWithBattleRoom = false;
+	/** Rooms are allowed to touch, bounds are shrunk by this much before testing */
+	float OverlapTolerance = 10.f;
+	float SpatialGridCellSize = 4000.f;
+	/**
+	 * Solves the door connected islands of the map on worker threads. The plan is the same for every thread count,
+	 * but not the plan of the sequential solve, and near misses with level geometry always count as blocked.
+	 */
+	bool SolveIslandsInParallel = false;
+	/** Before a room falls back to a portal, every exit point of its parent, the other room classes and other exits for the parent are tried */
+	bool SearchDoorPlacement = true;
+	/** Door placements one room may test during the search */
+	int32 DoorSearchBudget = 64;
+	/** Level geometry the map has to avoid, e.g. the safe rooms placed in the level */
+	TArray<FBox> StaticObstacles;
+};
+
+struct FMapLayoutRoom
+{
+	EMapLayoutRoomKind Kind = EMapLayoutRoomKind::Battle;
+	int32 TemplateIndex = INDEX_NONE;
+	FTransform Transform;
+	FBox WorldBounds{ForceInit};
+	bool IsPlaced = false;
+
+	/** Index of the room this one is connected to, INDEX_NONE for the start room */
+	int32 ParentIndex = INDEX_NONE;
+	/** Side rooms (puzzle rooms) go to the parent's SideRooms instead of NextRoom */
+	bool IsSideRoom = false;
+	EMapLayoutConnection Connection = EMapLayoutConnection::None;
+	/** Exit point or puzzle point index on the parent room */
+	int32 ParentPointIndex = INDEX_NONE;
+	bool IsParentPointPuzzlePoint = false;
+	EMapLayoutPortalSet PortalSet = EMapLayoutPortalSet::Battle;
+	int32 PortalIndex = INDEX_NONE;
+	int32 SafeRoomIndex = INDEX_NONE;
+	/** Seed for the room's enemy and entity spawners, independent of layout draws */
+	uint32 SpawnSeed = 0;
+
+	/** Points of this room that are still free once the whole layout is solved */
+	TArray<int32> AvailableExitPoints;
+	TArray<int32> AvailablePuzzlePoints;
+};
+
+struct FMapLayoutPlan
+{
+	uint32 Seed = 0;
+	TArray<FMapLayoutRoom> Rooms;
+	/** Rooms that collided at their door and were moved behind a portal */
+	int32 PortalFallbackCount = 0;
+	/** Rooms whose first door collided but that got one through the placement search */
+	int32 AvoidedPortalCount = 0;
+	int32 PlacementAttempts = 0;
+	/** Exact box tests after the broad phase */
+	int32 OverlapTests = 0;
+	/** Near misses with level geometry that were handed to the near miss query */
+	int32 NearMissQueries = 0;
+	/** Puzzle room frequency windows that ended without a free puzzle point */
+	int32 MissedPuzzleRoomCount = 0;
+	/** Filled by whoever produced the plan, not saved with it */
+	bool IsFromCache = false;
+	double SolveStartSeconds = 0;
+	double SolveSeconds = 0;
+
+	bool IsEmpty() const { return Rooms.IsEmpty(); }
+	SIZE_T GetAllocatedSize() const;
+};
+
+/**
+ * Computes a map layout from room footprints only, without a world or spawned actors.
+ * AMapGenerator turns the resulting plan into actors.
+ */
+class PVD_API FMapLayoutSolver
+{
+public:
+	/** Decides whether a room touching level geometry really collides, usually a physics query */
+	using FNearMissQuery = TFunction<bool(const FRoomFootprint& Footprint, const FTransform& RoomTransform)>;
+
+	FMapLayoutSolver(const FMapLayoutTemplates& InTemplates, const FMapLayoutSettings& InSettings);
+
+	/** Without a query every near miss with level geometry counts as blocked */
+	void SetNearMissQuery(FNearMissQuery InNearMissQuery) { NearMissQuery = MoveTemp(InNearMissQuery); }
+	/** Upper bound of workers with SolveIslandsInParallel, 0 uses every worker thread. Doesn't change the plan */
+	void SetMaxWorkerCount(int32 InMaxWorkerCount) { MaxWorkerCount = FMath::Max(InMaxWorkerCount, 0); }
+
+	FMapLayoutPlan Solve();
+
+	static FTransform GetWorldPoint(const FMapLayoutRoom& Room, const FTransform& LocalPoint);
+
+	/** Working memory kept by the solver, the returned plan is not included */
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	/** Placement state of one worker. Islands of a parallel solve only test their own rooms, a sequential solve tests the whole map */
+	struct FPlacementWorkspace
+	{
+		FRoomSpatialGrid RoomGrid;
+		/** Plan room index of every grid id */
+		TArray<int32> GridRooms;
+		TArray<int32> GridQueryResult;
+		bool TestsStaticObstacles = true;
+		int32 PlacementAttempts = 0;
+		int32 OverlapTests = 0;
+		int32 NearMissQueries = 0;
+		int32 PortalFallbackCount = 0;
+		int32 AvoidedPortalCount = 0;
+
+		/** Starts a new island, the counters keep running */
+		void ResetIsland(float CellSize, bool InTestsStaticObstacles);
+		SIZE_T GetAllocatedSize() const;
+	};
+
+	/** Unique rooms are removed from their sampler, so they stay unique for the whole generation */
+	int32 PickRandomTemplate(EMapLayoutRoomKind Kind, FMapRandomStream& Stream, bool RemovePickedRoomFromArray = false);
+	void BuildSamplers();
+	static int32 TakeRandomPoint(TArray<int32>& Points, FMapRandomStream& Stream);
+
+	/** Adds a room with its own layout and portal streams, the template is picked from the layout stream */
+	int32 AddRoom(EMapLayoutRoomKind Kind, int32 ParentIndex, bool IsSideRoom = false, bool RemovePickedRoomFromArray = false);
+	/** Places the room right away, or only records how to place it when islands are solved in parallel */
+	void PlaceRoom(int32 RoomIndex, bool ConnectWithPortal = false);
+	bool TryPlaceRoomWithDoor(FPlacementWorkspace& Workspace, int32 RoomIndex);
+	/** Parent exit points in random order until one is free, each test takes one from the budget */
+	bool TryExitPoints(FPlacementWorkspace& Workspace, int32 RoomIndex, int32& Budget, int32& OutAttempts);
+	/** Other room classes of the same kind at every exit point, not for unique rooms */
+	bool TryOtherTemplates(FPlacementWorkspace& Workspace, int32 RoomIndex, int32& Budget);
+	/** One step of backtracking: the parent moves to another exit of its own parent and the room tries again */
+	bool TryMoveParent(FPlacementWorkspace& Workspace, int32 RoomIndex, int32& Budget);
+	/** Free exits of the room that door placement may use, see the note on the ARoom rule it mirrors */
+	void GetCandidateExitPoints(const FMapLayoutRoom& RoomToConnect, TArray<int32>& OutExitPoints) const;
+	/** Entrance of the room turned against the exit point and moved onto it */
+	static FTransform GetDoorTransform(const FRoomFootprint& Footprint, const FTransform& ExitPoint);
+	void RemoveFromGrid(FPlacementWorkspace& Workspace, int32 RoomIndex);
+	void ResetRoomPoints(FMapLayoutRoom& Room) const;
+	void PlaceRoomWithPortal(FPlacementWorkspace& Workspace, int32 RoomIndex, bool IsAfterSafeRoom, const FVector& Location);
+	/** Last draw of a room behind a safe room, split off so a parallel solve can take it in room order */
+	void PickSafeRoom(int32 RoomIndex);
+	void PlaceBossRoom(int32& LastRoomIndex);
+	void MarkPlaced(FPlacementWorkspace& Workspace, FMapLayoutRoom& Room);
+	bool IsOverlapping(FPlacementWorkspace& Workspace, const FMapLayoutRoom& Room, const FTransform& RoomTransform, int32 IgnoreRoomIndex);
+
+	/** Places the recorded rooms: segments behind forced portals on worker threads, then the islands one after another */
+	void SolveIslands();
+	void SolveSegment(FPlacementWorkspace& Workspace, TConstArrayView<int32> SegmentRooms);
+	/** Moves every island from its local frame next to the islands before it, away from level geometry */
+	void PlaceIslands();
+	/** Adds the worker counters to the plan and hands it out */
+	FMapLayoutPlan FinishSolve();
+
+	const FRoomFootprint& GetFootprint(const FMapLayoutRoom& Room) const;
+
+	const FMapLayoutTemplates& Templates;
+	FMapLayoutSettings Settings;
+	FMapLayoutPlan Plan;
+	FNearMissQuery NearMissQuery;
+	/** One per worker, a sequential solve only uses the first */
+	TArray<FPlacementWorkspace> Workspaces;
+	int32 MaxWorkerCount = 0;
+	/** Indexed by EMapLayoutRoomKind */
+	FRoomSampler RoomSamplers[4];
+	FRoomSampler SafeRoomSampler;
+
+	FMapRandomStream RootRandom;
+	/** Per room streams, indexed like Plan.Rooms */
+	TArray<FMapRandomStream> LayoutStreams;
+	TArray<FMapRandomStream> PortalStreams;
+	FVector PortalRoomPlacementCurrentPosition{0, 0, 0};
+	/** Forward direction of the start room entrance, door placement never turns back against it */
+	FVector MapForward = FVector::ForwardVector;
+	bool IsLastRoomSafeRoom = false;
+
+	/** Recorded by PlaceRoom for SolveIslands, indexed like Plan.Rooms */
+	TBitArray<> ForcedPortalRooms;
+	TBitArray<> AfterSafeRooms;
+	/** First room of the island every room ended up in */
+	TArray<int32> IslandOfRoom;
+	/** Children of every room in plan order, indexed like Plan.Rooms and filled by AddRoom */
+	TArray<TArray<int32, TInlineAllocator<2>>> RoomChildren;
+	/** Grid id of every placed room in the workspace that placed it, indexed like Plan.Rooms */
+	TArray<int32> RoomGridIds;
+};
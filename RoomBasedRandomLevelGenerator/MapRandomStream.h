@@ -0,0 +1,94 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Keys used to split independent streams off the map seed */
+enum class EMapRandomPurpose : uint64
+{
+	Layout = 1,
+	Portal = 2,
+	Spawn = 3,
+	Generator = 4,
+	Chunk = 5
+};
+
+/**
+ * PCG32 generator for map generation. Cheap to create and to split, so every room and every
+ * purpose can draw from its own stream and decisions don't depend on the order of other draws.
+ */
+struct FMapRandomStream
+{
+	FMapRandomStream()
+		: FMapRandomStream(0)
+	{
+	}
+
+	explicit FMapRandomStream(uint64 InSeed, uint64 InStreamId = 0)
+		: Seed(InSeed), StreamId(InStreamId), State(0), Increment((InStreamId << 1u) | 1u)
+	{
+		NextUInt32();
+		State += InSeed;
+		NextUInt32();
+	}
+
+	FORCEINLINE uint32 NextUInt32()
+	{
+		const uint64 OldState = State;
+		State = OldState * 6364136223846793005ULL + Increment;
+		const uint32 XorShifted = static_cast<uint32>(((OldState >> 18u) ^ OldState) >> 27u);
+		const uint32 Rotation = static_cast<uint32>(OldState >> 59u);
+		return (XorShifted >> Rotation) | (XorShifted << ((0u - Rotation) & 31u));
+	}
+
+	/** Uniform in [Min, Max] without modulo bias */
+	int32 RandRange(int32 Min, int32 Max)
+	{
+		if (Min >= Max)
+		{
+			return Min;
+		}
+		const uint32 Range = static_cast<uint32>(Max - Min) + 1u;
+		const uint32 Threshold = (0u - Range) % Range;
+		for (;;)
+		{
+			const uint32 Value = NextUInt32();
+			if (Value >= Threshold)
+			{
+				return Min + static_cast<int32>(Value % Range);
+			}
+		}
+	}
+
+	/** Uniform in [0, 1) */
+	FORCEINLINE float GetFraction()
+	{
+		return (NextUInt32() >> 8) * (1.f / 16777216.f);
+	}
+
+	/** Independent stream derived from the seed and the key, no matter how much was drawn from this one */
+	FMapRandomStream Split(uint64 Key) const
+	{
+		return FMapRandomStream(Mix(Seed ^ Mix(Key + 0x9E3779B97F4A7C15ULL)), Mix(StreamId + Key));
+	}
+
+	FORCEINLINE FMapRandomStream Split(EMapRandomPurpose Purpose) const
+	{
+		return Split(static_cast<uint64>(Purpose));
+	}
+
+	FORCEINLINE uint64 GetSeed() const { return Seed; }
+
+private:
+	/** SplitMix64 finalizer */
+	static FORCEINLINE uint64 Mix(uint64 Value)
+	{
+		Value = (Value ^ (Value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		Value = (Value ^ (Value >> 27)) * 0x94D049BB133111EBULL;
+		return Value ^ (Value >> 31);
+	}
+
+	uint64 Seed;
+	uint64 StreamId;
+	uint64 State;
+	uint64 Increment;
+};
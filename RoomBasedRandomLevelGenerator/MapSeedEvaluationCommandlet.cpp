@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "../PCG/MapSeedEvaluationCommandlet.h"
+
+#include "../PCG/MapLayoutMetrics.h"
+#include "Async/ParallelFor.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "PVD/PVD.h"
+
+int32 UMapSeedEvaluationCommandlet::Main(const FString& Params)
+{
+	FMapLayoutTemplates Templates;
+	FMapLayoutSettings Settings;
+	if (!LoadLayoutInput(Params, Templates, Settings))
+	{
+		return 1;
+	}
+
+	uint32 FirstSeed = 0;
+	int32 SeedCount = 10000;
+	int32 TopCount = 1000;
+	FString OutputPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("MapSeeds.csv"));
+	FParse::Value(*Params, TEXT("FirstSeed="), FirstSeed);
+	FParse::Value(*Params, TEXT("SeedCount="), SeedCount);
+	FParse::Value(*Params, TEXT("Top="), TopCount);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+	SeedCount = FMath::Max(SeedCount, 0);
+
+	PVD_LOG(Display, TEXT("Evaluating %d seeds from %u with %d battle rooms"), SeedCount, FirstSeed, Settings.BattleRoomCount);
+	PVD_LOG(Display, TEXT("Seeds are solved without level geometry, levels with safe rooms or other static obstacles can give other maps in game"));
+	const double StartTime = FPlatformTime::Seconds();
+
+	/** Every seed gets its own solver, templates are shared read only */
+	TArray<FMapLayoutMetrics> Results;
+	Results.SetNum(SeedCount);
+	ParallelFor(SeedCount, [&Templates, &Settings, &Results, FirstSeed](int32 Index)
+	{
+		FMapLayoutSettings SeedSettings = Settings;
+		SeedSettings.Seed = FirstSeed + static_cast<uint32>(Index);
+		FMapLayoutSolver Solver(Templates, SeedSettings);
+		Results[Index] = FMapLayoutMetrics::Evaluate(Solver.Solve(), SeedSettings);
+	});
+
+	const double SolveSeconds = FPlatformTime::Seconds() - StartTime;
+	Results.Sort([](const FMapLayoutMetrics& A, const FMapLayoutMetrics& B)
+	{
+		return A.IsBetterThan(B);
+	});
+
+	int32 CompleteCount = 0;
+	int32 FallbackFreeCount = 0;
+	for (const FMapLayoutMetrics& Metrics : Results)
+	{
+		CompleteCount += Metrics.IsComplete ? 1 : 0;
+		FallbackFreeCount += Metrics.IsComplete && Metrics.PortalFallbackCount == 0 ? 1 : 0;
+	}
+
+	const int32 RowCount = TopCount > 0 ? FMath::Min(TopCount, Results.Num()) : Results.Num();
+	/** Kept in the file, the table is read long after the commandlet log is gone */
+	FString Table = TEXT("# Solved without level geometry: safe rooms are no static obstacles and near misses are not resolved with physics, maps can differ in levels with static obstacles\n");
+	Table += TEXT("Rank,Seed,Complete,PortalFallbacks,Portals,MainPathLength,MainPathDistance,BoundingArea,PuzzleRoomSuccess,Rooms\n");
+	for (int32 Rank = 0; Rank < RowCount; Rank++)
+	{
+		const FMapLayoutMetrics& Metrics = Results[Rank];
+		Table += FString::Printf(TEXT("%d,%u,%d,%d,%d,%d,%.1f,%.1f,%.3f,%d\n"), Rank + 1, Metrics.Seed, Metrics.IsComplete ? 1 : 0,
+			Metrics.PortalFallbackCount, Metrics.PortalCount, Metrics.MainPathLength, Metrics.MainPathDistance,
+			Metrics.BoundingArea, Metrics.PuzzleRoomSuccess, Metrics.RoomCount);
+	}
+	if (!FFileHelper::SaveStringToFile(Table, *OutputPath))
+	{
+		PVD_LOG(Error, TEXT("Seed table could not be written to %s"), *OutputPath);
+		return 1;
+	}
+
+	PVD_LOG(Display, TEXT("%d seeds solved in %.2fs (%.0f seeds/s), %d complete, %d without portal fallback. Top %d written to %s"),
+		SeedCount, SolveSeconds, SeedCount / FMath::Max(SolveSeconds, 0.001), CompleteCount, FallbackFreeCount, RowCount, *OutputPath);
+	return 0;
+}
@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MapLayoutCommandlet.h"
+#include "MapSeedEvaluationCommandlet.generated.h"
+
+/**
+ * Solves the layouts of a seed range on every core and writes the seeds ranked by FMapLayoutMetrics as CSV.
+ * There is no level here: the safe rooms the game passes as static obstacles are missing and no near miss is resolved
+ * with physics. For levels with static obstacles the ranked maps can differ from the ones players get, the CSV says so
+ * in its first line.
+ * Example Usage : UnrealEditor-Cmd.exe PVD.uproject -run=MapSeedEvaluation -Container=/Game/PCG/DA_RoomContainer
+ *                 -FirstSeed=0 -SeedCount=100000 -Top=1000 -Output=Saved/MapSeeds.csv
+ */
+UCLASS()
+class PVD_API UMapSeedEvaluationCommandlet : public UMapLayoutCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	virtual int32 Main(const FString& Params) override;
+};
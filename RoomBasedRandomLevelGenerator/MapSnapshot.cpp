@@ -0,0 +1,320 @@
+#include "../PCG/MapSnapshot.h"
+
+#include "Portal.h"
+#include "Room.h"
+#include "../PCG/RoomTemplateTable.h"
+#include "PVD/Data/PCGRoomContainer.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace
+{
+	constexpr uint32 MapSnapshotMagic = 0x4D534E50; // "MSNP"
+
+	enum EMapSnapshotRoomFlags : uint8
+	{
+		PlacedFlag = 1 << 0,
+		SideRoomFlag = 1 << 1,
+		PuzzlePointFlag = 1 << 2,
+		EntitiesSpawnedFlag = 1 << 3
+	};
+
+	TSubclassOf<ARoom> GetRoomClass(const UPCGRoomContainer* RoomContainer, const FMapLayoutRoom& Room)
+	{
+		switch (Room.Kind)
+		{
+		case EMapLayoutRoomKind::Start:
+			return RoomContainer->StartRooms[Room.TemplateIndex];
+		case EMapLayoutRoomKind::Puzzle:
+			return RoomContainer->PuzzleRooms[Room.TemplateIndex];
+		case EMapLayoutRoomKind::Boss:
+			return RoomContainer->BossRooms[Room.TemplateIndex];
+		default:
+			return RoomContainer->BattleRooms[Room.TemplateIndex];
+		}
+	}
+
+	/** Null for an index outside the set, the snapshot then fails to load instead of picking another portal */
+	TSubclassOf<APortal> GetPortalClass(const UPCGRoomContainer* RoomContainer, const FMapLayoutRoom& Room)
+	{
+		auto GetPortal = [&Room](const auto& Portals) -> TSubclassOf<APortal>
+		{
+			return Portals.IsValidIndex(Room.PortalIndex) ? TSubclassOf<APortal>(Portals[Room.PortalIndex]) : TSubclassOf<APortal>();
+		};
+		switch (Room.PortalSet)
+		{
+		case EMapLayoutPortalSet::Puzzle:
+			return GetPortal(RoomContainer->PuzzleRoomPortals);
+		case EMapLayoutPortalSet::SafeRoom:
+			return GetPortal(RoomContainer->SafeRoomPortals);
+		case EMapLayoutPortalSet::StartRoom:
+			return RoomContainer->StartRoomPortal;
+		default:
+			return GetPortal(RoomContainer->BattleRoomPortals);
+		}
+	}
+
+	template <typename TClassArray>
+	int32 FindClassIndex(const TClassArray& Classes, const FString& ClassPath)
+	{
+		for (int32 ClassIndex = 0; ClassIndex < Classes.Num(); ClassIndex++)
+		{
+			if (GetPathNameSafe(Classes[ClassIndex].Get()) == ClassPath)
+			{
+				return ClassIndex;
+			}
+		}
+		return INDEX_NONE;
+	}
+
+	int32 FindRoomClassIndex(const UPCGRoomContainer* RoomContainer, EMapLayoutRoomKind Kind, const FString& ClassPath)
+	{
+		switch (Kind)
+		{
+		case EMapLayoutRoomKind::Start:
+			return FindClassIndex(RoomContainer->StartRooms, ClassPath);
+		case EMapLayoutRoomKind::Puzzle:
+			return FindClassIndex(RoomContainer->PuzzleRooms, ClassPath);
+		case EMapLayoutRoomKind::Boss:
+			return FindClassIndex(RoomContainer->BossRooms, ClassPath);
+		default:
+			return FindClassIndex(RoomContainer->BattleRooms, ClassPath);
+		}
+	}
+
+	int32 FindPortalClassIndex(const UPCGRoomContainer* RoomContainer, EMapLayoutPortalSet PortalSet, const FString& ClassPath)
+	{
+		switch (PortalSet)
+		{
+		case EMapLayoutPortalSet::Puzzle:
+			return FindClassIndex(RoomContainer->PuzzleRoomPortals, ClassPath);
+		case EMapLayoutPortalSet::SafeRoom:
+			return FindClassIndex(RoomContainer->SafeRoomPortals, ClassPath);
+		case EMapLayoutPortalSet::StartRoom:
+			return GetPathNameSafe(RoomContainer->StartRoomPortal.Get()) == ClassPath ? 0 : INDEX_NONE;
+		default:
+			return FindClassIndex(RoomContainer->BattleRoomPortals, ClassPath);
+		}
+	}
+
+	FORCEINLINE bool HasPortal(const FMapLayoutRoom& Room)
+	{
+		return Room.Connection == EMapLayoutConnection::Portal || Room.Connection == EMapLayoutConnection::SafeRoomPortal;
+	}
+
+	/** Indices that may be INDEX_NONE are stored one up, so they stay a single packed byte for small maps */
+	FORCEINLINE uint32 ToPackedIndex(int32 Index)
+	{
+		return static_cast<uint32>(Index + 1);
+	}
+
+	FORCEINLINE int32 FromPackedIndex(uint32 Value)
+	{
+		return static_cast<int32>(Value) - 1;
+	}
+}
+
+bool FMapSnapshot::Save(const FMapLayoutPlan& Plan, const UPCGRoomContainer* RoomContainer, const TArray<AActor*>& SafeRooms, const TBitArray<>& SpawnedRooms, TArray<uint8>& OutData)
+{
+	if (Plan.IsEmpty() || RoomContainer == nullptr)
+	{
+		return false;
+	}
+
+	/** Class paths and safe room names, rooms refer to them by index so each path is stored once */
+	TArray<FString> Names;
+	TMap<FString, int32> NameIds;
+	auto GetNameId = [&Names, &NameIds](const FString& Name) -> uint32
+	{
+		if (const int32* NameId = NameIds.Find(Name))
+		{
+			return static_cast<uint32>(*NameId);
+		}
+		NameIds.Add(Name, Names.Num());
+		return static_cast<uint32>(Names.Add(Name));
+	};
+
+	TArray<uint8> RoomData;
+	FMemoryWriter RoomAr(RoomData);
+	for (int32 RoomIndex = 0; RoomIndex < Plan.Rooms.Num(); RoomIndex++)
+	{
+		const FMapLayoutRoom& Room = Plan.Rooms[RoomIndex];
+		uint8 Kind = static_cast<uint8>(Room.Kind);
+		uint8 Flags = (Room.IsPlaced ? PlacedFlag : 0) | (Room.IsSideRoom ? SideRoomFlag : 0) | (Room.IsParentPointPuzzlePoint ? PuzzlePointFlag : 0)
+			| (SpawnedRooms.IsValidIndex(RoomIndex) && SpawnedRooms[RoomIndex] ? EntitiesSpawnedFlag : 0);
+		uint32 ClassId = GetNameId(GetPathNameSafe(GetRoomClass(RoomContainer, Room).Get()));
+		/** Rooms only ever turn around Z, location and yaw rebuild the transform */
+		FVector Location = Room.Transform.GetLocation();
+		double Yaw = Room.Transform.Rotator().Yaw;
+		uint8 Connection = static_cast<uint8>(Room.Connection);
+		uint32 ParentIndex = ToPackedIndex(Room.ParentIndex);
+		uint32 ParentPointIndex = ToPackedIndex(Room.ParentPointIndex);
+		uint8 PortalSet = static_cast<uint8>(Room.PortalSet);
+		uint32 PortalClassId = HasPortal(Room) ? ToPackedIndex(GetNameId(GetPathNameSafe(GetPortalClass(RoomContainer, Room).Get()))) : 0;
+		/** Safe rooms are level actors, a snapshot made without them has no safe room connections */
+		const bool HasSafeRoom = SafeRooms.IsValidIndex(Room.SafeRoomIndex) && IsValid(SafeRooms[Room.SafeRoomIndex]);
+		uint32 SafeRoomNameId = HasSafeRoom ? ToPackedIndex(GetNameId(SafeRooms[Room.SafeRoomIndex]->GetName())) : 0;
+		uint32 SpawnSeed = Room.SpawnSeed;
+
+		RoomAr << Kind << Flags;
+		RoomAr.SerializeIntPacked(ClassId);
+		RoomAr << Location << Yaw << Connection;
+		RoomAr.SerializeIntPacked(ParentIndex);
+		RoomAr.SerializeIntPacked(ParentPointIndex);
+		RoomAr << PortalSet;
+		RoomAr.SerializeIntPacked(PortalClassId);
+		RoomAr.SerializeIntPacked(SafeRoomNameId);
+		RoomAr << SpawnSeed;
+	}
+
+	OutData.Reset();
+	FMemoryWriter Ar(OutData);
+	uint32 Magic = MapSnapshotMagic;
+	int32 SnapshotVersion = Version;
+	FMapLayoutPlan& Counters = const_cast<FMapLayoutPlan&>(Plan);
+	Ar << Magic << SnapshotVersion;
+	Ar << Counters.Seed << Counters.PortalFallbackCount << Counters.AvoidedPortalCount << Counters.PlacementAttempts;
+	Ar << Counters.OverlapTests << Counters.NearMissQueries << Counters.MissedPuzzleRoomCount;
+	Ar << Names;
+	uint32 RoomCount = static_cast<uint32>(Plan.Rooms.Num());
+	Ar.SerializeIntPacked(RoomCount);
+	Ar.Serialize(RoomData.GetData(), RoomData.Num());
+	return !Ar.IsError();
+}
+
+bool FMapSnapshot::Load(const TArray<uint8>& Data, const UPCGRoomContainer* RoomContainer, const TArray<AActor*>& SafeRooms, URoomTemplateTable* TemplateTable,
+	FMapLayoutPlan& OutPlan, TBitArray<>& OutSpawnedRooms, FString& OutError)
+{
+	if (RoomContainer == nullptr || TemplateTable == nullptr)
+	{
+		OutError = TEXT("No room container to restore the map from");
+		return false;
+	}
+
+	FMemoryReader Ar(Data);
+	uint32 Magic = 0;
+	int32 SnapshotVersion = 0;
+	Ar << Magic;
+	if (Magic != MapSnapshotMagic)
+	{
+		OutError = TEXT("Data is not a map snapshot");
+		return false;
+	}
+	Ar << SnapshotVersion;
+	if (SnapshotVersion != Version)
+	{
+		OutError = FString::Printf(TEXT("Map snapshot version %d, expected %d"), SnapshotVersion, Version);
+		return false;
+	}
+
+	FMapLayoutPlan Plan;
+	Ar << Plan.Seed << Plan.PortalFallbackCount << Plan.AvoidedPortalCount << Plan.PlacementAttempts;
+	Ar << Plan.OverlapTests << Plan.NearMissQueries << Plan.MissedPuzzleRoomCount;
+	TArray<FString> Names;
+	Ar << Names;
+	uint32 RoomCount = 0;
+	Ar.SerializeIntPacked(RoomCount);
+	/** Every room takes more than one byte, anything above that is a broken blob */
+	if (Ar.IsError() || RoomCount == 0 || RoomCount > static_cast<uint32>(Data.Num()))
+	{
+		OutError = TEXT("Map snapshot is truncated");
+		return false;
+	}
+
+	/** Names are resolved once, most rooms share a few classes */
+	TMap<int32, int32> SafeRoomIndices;
+	auto FindSafeRoomIndex = [&SafeRooms, &SafeRoomIndices](const FString& Name, int32 NameId)
+	{
+		if (const int32* SafeRoomIndex = SafeRoomIndices.Find(NameId))
+		{
+			return *SafeRoomIndex;
+		}
+		const int32 SafeRoomIndex = SafeRooms.IndexOfByPredicate([&Name](const AActor* SafeRoom) { return IsValid(SafeRoom) && SafeRoom->GetName() == Name; });
+		return SafeRoomIndices.Add(NameId, SafeRoomIndex);
+	};
+
+	Plan.Rooms.SetNum(static_cast<int32>(RoomCount));
+	OutSpawnedRooms.Init(false, Plan.Rooms.Num());
+	for (int32 RoomIndex = 0; RoomIndex < Plan.Rooms.Num(); RoomIndex++)
+	{
+		FMapLayoutRoom& Room = Plan.Rooms[RoomIndex];
+		uint8 Kind = 0;
+		uint8 Flags = 0;
+		uint32 ClassId = 0;
+		FVector Location;
+		double Yaw = 0;
+		uint8 Connection = 0;
+		uint32 ParentIndex = 0;
+		uint32 ParentPointIndex = 0;
+		uint8 PortalSet = 0;
+		uint32 PortalClassId = 0;
+		uint32 SafeRoomNameId = 0;
+		Ar << Kind << Flags;
+		Ar.SerializeIntPacked(ClassId);
+		Ar << Location << Yaw << Connection;
+		Ar.SerializeIntPacked(ParentIndex);
+		Ar.SerializeIntPacked(ParentPointIndex);
+		Ar << PortalSet;
+		Ar.SerializeIntPacked(PortalClassId);
+		Ar.SerializeIntPacked(SafeRoomNameId);
+		Ar << Room.SpawnSeed;
+		if (Ar.IsError() || Kind > static_cast<uint8>(EMapLayoutRoomKind::Boss) || Connection > static_cast<uint8>(EMapLayoutConnection::SafeRoomPortal)
+			|| PortalSet > static_cast<uint8>(EMapLayoutPortalSet::StartRoom) || !Names.IsValidIndex(static_cast<int32>(ClassId)))
+		{
+			OutError = FString::Printf(TEXT("Map snapshot is broken at room %d"), RoomIndex);
+			return false;
+		}
+
+		Room.Kind = static_cast<EMapLayoutRoomKind>(Kind);
+		Room.IsPlaced = (Flags & PlacedFlag) != 0;
+		Room.IsSideRoom = (Flags & SideRoomFlag) != 0;
+		Room.IsParentPointPuzzlePoint = (Flags & PuzzlePointFlag) != 0;
+		OutSpawnedRooms[RoomIndex] = (Flags & EntitiesSpawnedFlag) != 0;
+		Room.Transform = FTransform(FRotator(0, Yaw, 0), Location);
+		Room.Connection = static_cast<EMapLayoutConnection>(Connection);
+		Room.ParentIndex = FromPackedIndex(ParentIndex);
+		Room.ParentPointIndex = FromPackedIndex(ParentPointIndex);
+		Room.PortalSet = static_cast<EMapLayoutPortalSet>(PortalSet);
+		/** Parents always come before their children, the generator connects rooms in plan order */
+		if (Room.ParentIndex >= RoomIndex)
+		{
+			OutError = FString::Printf(TEXT("Map snapshot is broken at room %d"), RoomIndex);
+			return false;
+		}
+
+		/** A class the container lost would silently give another map, so it fails instead */
+		const FString& RoomClassPath = Names[ClassId];
+		Room.TemplateIndex = FindRoomClassIndex(RoomContainer, Room.Kind, RoomClassPath);
+		if (Room.TemplateIndex == INDEX_NONE)
+		{
+			OutError = FString::Printf(TEXT("Room class %s is not in the room container"), *RoomClassPath);
+			return false;
+		}
+		if (HasPortal(Room))
+		{
+			const int32 PortalNameId = FromPackedIndex(PortalClassId);
+			Room.PortalIndex = Names.IsValidIndex(PortalNameId) ? FindPortalClassIndex(RoomContainer, Room.PortalSet, Names[PortalNameId]) : INDEX_NONE;
+			if (Room.PortalIndex == INDEX_NONE)
+			{
+				OutError = FString::Printf(TEXT("Portal class %s is not in the room container"), Names.IsValidIndex(PortalNameId) ? *Names[PortalNameId] : TEXT("None"));
+				return false;
+			}
+		}
+		if (SafeRoomNameId != 0)
+		{
+			const int32 SafeRoomNameIndex = FromPackedIndex(SafeRoomNameId);
+			Room.SafeRoomIndex = Names.IsValidIndex(SafeRoomNameIndex) ? FindSafeRoomIndex(Names[SafeRoomNameIndex], SafeRoomNameIndex) : INDEX_NONE;
+			if (Room.SafeRoomIndex == INDEX_NONE)
+			{
+				OutError = FString::Printf(TEXT("Safe room %s is not in this level"), Names.IsValidIndex(SafeRoomNameIndex) ? *Names[SafeRoomNameIndex] : TEXT("None"));
+				return false;
+			}
+		}
+
+		/** Bounds are not stored, the baked template of the class gives them back exactly */
+		Room.WorldBounds = TemplateTable->FindOrBake(GetRoomClass(RoomContainer, Room)).LocalBounds.TransformBy(Room.Transform);
+	}
+
+	OutPlan = MoveTemp(Plan);
+	return true;
+}
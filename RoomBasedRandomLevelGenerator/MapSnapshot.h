@@ -0,0 +1,25 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MapLayoutSolver.h"
+
+class UPCGRoomContainer;
+class URoomTemplateTable;
+
+/**
+ * A generated map as a small versioned binary blob that is instantiated again without solving the layout.
+ * Room and portal classes are stored by path and safe rooms by name instead of indices, so restoring with a changed
+ * room container either finds the same classes again or fails, it never builds another map.
+ */
+class PVD_API FMapSnapshot
+{
+public:
+	/** Bump whenever the blob layout changes */
+	static constexpr int32 Version = 1;
+
+	/** Plan as it was instantiated from the container. SpawnedRooms marks the rooms whose entities are spawned already */
+	static bool Save(const FMapLayoutPlan& Plan, const UPCGRoomContainer* RoomContainer, const TArray<AActor*>& SafeRooms, const TBitArray<>& SpawnedRooms, TArray<uint8>& OutData);
+	/** Plan with the indices of the given container and safe rooms, room bounds come from the template table */
+	static bool Load(const TArray<uint8>& Data, const UPCGRoomContainer* RoomContainer, const TArray<AActor*>& SafeRooms, URoomTemplateTable* TemplateTable,
+		FMapLayoutPlan& OutPlan, TBitArray<>& OutSpawnedRooms, FString& OutError);
+};
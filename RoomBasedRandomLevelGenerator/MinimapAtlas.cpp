@@ -0,0 +1,162 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "../PCG/MinimapAtlas.h"
+
+#include "Engine/Canvas.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "Kismet/KismetRenderingLibrary.h"
+
+namespace
+{
+	constexpr float AtlasPadding = 2.f;
+
+	/** World XY to atlas pixels relative to the island's top left corner, +X is up */
+	FVector2D WorldToIsland(const FVector& WorldLocation, const FBox2D& IslandBounds, float PixelsPerWorldUnit)
+	{
+		return FVector2D(WorldLocation.Y - IslandBounds.Min.Y, IslandBounds.Max.X - WorldLocation.X) * PixelsPerWorldUnit;
+	}
+
+	/** Shelf packing, islands are placed tallest first in rows of at most RowWidth pixels */
+	FIntPoint PackIslands(const TArray<FVector2D>& IslandSizes, float RowWidth, TArray<FVector2D>& OutPositions)
+	{
+		TArray<int32> Order;
+		for (int32 Index = 0; Index < IslandSizes.Num(); Index++)
+		{
+			Order.Add(Index);
+		}
+		Order.Sort([&IslandSizes](int32 A, int32 B) { return IslandSizes[A].Y > IslandSizes[B].Y; });
+
+		OutPositions.SetNum(IslandSizes.Num());
+		FVector2D Cursor = FVector2D::ZeroVector;
+		float RowHeight = 0.f;
+		float AtlasWidth = 0.f;
+		for (const int32 Index : Order)
+		{
+			const FVector2D Size = IslandSizes[Index] + FVector2D(AtlasPadding * 2);
+			if (Cursor.X > 0 && Cursor.X + Size.X > RowWidth)
+			{
+				Cursor = FVector2D(0, Cursor.Y + RowHeight);
+				RowHeight = 0.f;
+			}
+			OutPositions[Index] = Cursor + FVector2D(AtlasPadding);
+			Cursor.X += Size.X;
+			RowHeight = FMath::Max(RowHeight, Size.Y);
+			AtlasWidth = FMath::Max(AtlasWidth, Cursor.X);
+		}
+		return FIntPoint(FMath::CeilToInt32(AtlasWidth), FMath::CeilToInt32(Cursor.Y + RowHeight));
+	}
+}
+
+FVector2D FMinimapAtlas::GetAtlasPosition(const FVector& WorldLocation, int32 Island) const
+{
+	if (!Islands.IsValidIndex(Island) || Texture == nullptr)
+	{
+		return FVector2D::ZeroVector;
+	}
+	const FMinimapAtlasIsland& AtlasIsland = Islands[Island];
+	const FVector2D TextureSize(Texture->SizeX, Texture->SizeY);
+	return AtlasIsland.AtlasRect.Min + WorldToIsland(WorldLocation, AtlasIsland.WorldBounds, PixelsPerWorldUnit) / TextureSize;
+}
+
+void FMinimapAtlasBuilder::AddRoom(ARoom* Room, UTexture* Texture, const FTransform& Transform, const FBox& LocalBounds, int32 Island)
+{
+	Rooms.Add({Room, Texture, Transform, LocalBounds, FMath::Max(Island, 0)});
+}
+
+void FMinimapAtlasBuilder::AddPortal(ARoom* Room, const FVector& Location, float Yaw)
+{
+	Portals.Add({Room, Location, Yaw});
+}
+
+void FMinimapAtlasBuilder::Reset()
+{
+	Rooms.Reset();
+	Portals.Reset();
+}
+
+FMinimapAtlas FMinimapAtlasBuilder::Build(UObject* WorldContextObject, float PixelsPerWorldUnit, int32 MaxAtlasSize) const
+{
+	FMinimapAtlas Atlas;
+	Atlas.Portals = Portals;
+	if (Rooms.IsEmpty() || PixelsPerWorldUnit <= 0.f)
+	{
+		return Atlas;
+	}
+
+	/** Island world bounds from the rotated room footprints */
+	for (const FRoomEntry& Entry : Rooms)
+	{
+		if (Entry.Island >= Atlas.Islands.Num())
+		{
+			Atlas.Islands.SetNum(Entry.Island + 1);
+		}
+		const FBox WorldBounds = Entry.LocalBounds.TransformBy(Entry.Transform);
+		Atlas.Islands[Entry.Island].WorldBounds += FBox2D(FVector2D(WorldBounds.Min), FVector2D(WorldBounds.Max));
+	}
+
+	TArray<FVector2D> IslandSizes;
+	TArray<FVector2D> IslandPositions;
+	FIntPoint AtlasSize;
+	for (int32 Pass = 0; Pass < 2; Pass++)
+	{
+		IslandSizes.Reset();
+		double TotalArea = 0;
+		for (const FMinimapAtlasIsland& Island : Atlas.Islands)
+		{
+			/** Swapped because +X is up */
+			const FVector2D Size = Island.WorldBounds.bIsValid ? FVector2D(Island.WorldBounds.GetSize().Y, Island.WorldBounds.GetSize().X) * PixelsPerWorldUnit : FVector2D::ZeroVector;
+			IslandSizes.Add(Size);
+			TotalArea += (Size.X + AtlasPadding * 2) * (Size.Y + AtlasPadding * 2);
+		}
+		float MaxIslandWidth = 0.f;
+		for (const FVector2D& Size : IslandSizes)
+		{
+			MaxIslandWidth = FMath::Max(MaxIslandWidth, Size.X + AtlasPadding * 2);
+		}
+		AtlasSize = PackIslands(IslandSizes, FMath::Max(FMath::Sqrt(TotalArea), MaxIslandWidth), IslandPositions);
+		if (AtlasSize.GetMax() <= MaxAtlasSize)
+		{
+			break;
+		}
+		PixelsPerWorldUnit *= static_cast<float>(MaxAtlasSize) / AtlasSize.GetMax() * 0.95f;
+	}
+	AtlasSize = FIntPoint(FMath::Clamp(AtlasSize.X, 1, MaxAtlasSize), FMath::Clamp(AtlasSize.Y, 1, MaxAtlasSize));
+	Atlas.PixelsPerWorldUnit = PixelsPerWorldUnit;
+
+	Atlas.Texture = UKismetRenderingLibrary::CreateRenderTarget2D(WorldContextObject, AtlasSize.X, AtlasSize.Y, RTF_RGBA8);
+	if (Atlas.Texture == nullptr)
+	{
+		return Atlas;
+	}
+	UKismetRenderingLibrary::ClearRenderTarget2D(WorldContextObject, Atlas.Texture, FLinearColor::Transparent);
+
+	const FVector2D TextureSize(AtlasSize);
+	for (int32 IslandIndex = 0; IslandIndex < Atlas.Islands.Num(); IslandIndex++)
+	{
+		Atlas.Islands[IslandIndex].AtlasRect = FBox2D(IslandPositions[IslandIndex] / TextureSize, (IslandPositions[IslandIndex] + IslandSizes[IslandIndex]) / TextureSize);
+	}
+
+	UCanvas* Canvas = nullptr;
+	FVector2D CanvasSize;
+	FDrawToRenderTargetContext Context;
+	UKismetRenderingLibrary::BeginDrawCanvasToRenderTarget(WorldContextObject, Atlas.Texture, Canvas, CanvasSize, Context);
+	for (const FRoomEntry& Entry : Rooms)
+	{
+		const FMinimapAtlasIsland& Island = Atlas.Islands[Entry.Island];
+		const FVector Center = Entry.Transform.TransformPosition(Entry.LocalBounds.GetCenter());
+		const FVector2D Position = IslandPositions[Entry.Island] + WorldToIsland(Center, Island.WorldBounds, PixelsPerWorldUnit);
+		const FVector Scale = Entry.Transform.GetScale3D();
+		/** Texture width runs along the room's Y axis and its height along X */
+		const FVector2D Size = FVector2D(Entry.LocalBounds.GetSize().Y * Scale.Y, Entry.LocalBounds.GetSize().X * Scale.X) * PixelsPerWorldUnit;
+
+		Atlas.Rooms.Add({Entry.Room, Entry.Island, Position / TextureSize});
+		if (Canvas && Entry.Texture)
+		{
+			Canvas->K2_DrawTexture(Entry.Texture, Position - Size * 0.5f, Size, FVector2D::ZeroVector, FVector2D::UnitVector,
+				FLinearColor::White, BLEND_Translucent, Entry.Transform.Rotator().Yaw, FVector2D(0.5f, 0.5f));
+		}
+	}
+	UKismetRenderingLibrary::EndDrawCanvasToRenderTarget(WorldContextObject, Context);
+	return Atlas;
+}
@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "MinimapAtlas.generated.h"
+
+class ARoom;
+class UTexture;
+class UTextureRenderTarget2D;
+
+/** Door connected rooms share an island, portals lead to other islands */
+USTRUCT(BlueprintType)
+struct FMinimapAtlasIsland
+{
+	GENERATED_BODY()
+
+	/** World XY area of the island */
+	UPROPERTY(BlueprintReadOnly)
+	FBox2D WorldBounds{ForceInit};
+	/** Where the island is in the atlas texture, in UV */
+	UPROPERTY(BlueprintReadOnly)
+	FBox2D AtlasRect{ForceInit};
+};
+
+USTRUCT(BlueprintType)
+struct FMinimapAtlasRoom
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	ARoom* Room = nullptr;
+	UPROPERTY(BlueprintReadOnly)
+	int32 Island = INDEX_NONE;
+	/** Room center in the atlas texture, in UV */
+	UPROPERTY(BlueprintReadOnly)
+	FVector2D AtlasPosition = FVector2D::ZeroVector;
+};
+
+USTRUCT(BlueprintType)
+struct FMinimapAtlasPortal
+{
+	GENERATED_BODY()
+
+	/** Room the portal or door leads out of */
+	UPROPERTY(BlueprintReadOnly)
+	ARoom* Room = nullptr;
+	UPROPERTY(BlueprintReadOnly)
+	FVector Location = FVector::ZeroVector;
+	UPROPERTY(BlueprintReadOnly)
+	float Yaw = 0.f;
+};
+
+/**
+ * The whole map pre-rendered into one texture. +X of the world is up in the atlas and +Y is right,
+ * room textures are drawn with the room's forward pointing up before the room's yaw is applied.
+ */
+USTRUCT(BlueprintType)
+struct PVD_API FMinimapAtlas
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	UTextureRenderTarget2D* Texture = nullptr;
+	UPROPERTY(BlueprintReadOnly)
+	float PixelsPerWorldUnit = 0.f;
+	UPROPERTY(BlueprintReadOnly)
+	TArray<FMinimapAtlasIsland> Islands;
+	UPROPERTY(BlueprintReadOnly)
+	TArray<FMinimapAtlasRoom> Rooms;
+	UPROPERTY(BlueprintReadOnly)
+	TArray<FMinimapAtlasPortal> Portals;
+
+	/** UV of a world location on the given island, e.g. to place the player marker */
+	FVector2D GetAtlasPosition(const FVector& WorldLocation, int32 Island) const;
+};
+
+UINTERFACE(BlueprintType)
+class UMinimapAtlasReceiver : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/** Minimap widgets implementing this get the finished map in one call instead of one SpawnMap/SpawnPortal per room */
+class PVD_API IMinimapAtlasReceiver
+{
+	GENERATED_BODY()
+
+public:
+	UFUNCTION(BlueprintNativeEvent, BlueprintCallable)
+	void SetMinimapAtlas(const FMinimapAtlas& Atlas);
+};
+
+/** Collects the rooms of a map and composes the minimap atlas from their minimap textures */
+class PVD_API FMinimapAtlasBuilder
+{
+public:
+	/** LocalBounds is the room's footprint relative to its root, the texture covers its XY extent */
+	void AddRoom(ARoom* Room, UTexture* Texture, const FTransform& Transform, const FBox& LocalBounds, int32 Island);
+	void AddPortal(ARoom* Room, const FVector& Location, float Yaw);
+	void Reset();
+	FORCEINLINE bool IsEmpty() const { return Rooms.IsEmpty(); }
+
+	/** Renders every room in one canvas pass, the resolution is lowered when the atlas would exceed MaxAtlasSize */
+	FMinimapAtlas Build(UObject* WorldContextObject, float PixelsPerWorldUnit, int32 MaxAtlasSize) const;
+
+private:
+	struct FRoomEntry
+	{
+		ARoom* Room;
+		UTexture* Texture;
+		FTransform Transform;
+		FBox LocalBounds;
+		int32 Island;
+	};
+
+	TArray<FRoomEntry> Rooms;
+	TArray<FMinimapAtlasPortal> Portals;
+};
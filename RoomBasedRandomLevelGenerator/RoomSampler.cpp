@@ -0,0 +1,123 @@
+#include "../PCG/RoomSampler.h"
+
+void FRoomSampler::Build(TConstArrayView<float> InWeights)
+{
+	const int32 Count = InWeights.Num();
+	Weights = InWeights;
+	Removed.Init(false, Count);
+	Probabilities.SetNumUninitialized(Count);
+	Aliases.SetNumUninitialized(Count);
+	ScaledWeights.SetNumUninitialized(Count);
+	Small.Reset(Count);
+	Large.Reset(Count);
+	Restore();
+}
+
+void FRoomSampler::Restore()
+{
+	RemainingCount = 0;
+	for (int32 Index = 0; Index < Weights.Num(); Index++)
+	{
+		Removed[Index] = false;
+		RemainingCount += Weights[Index] > 0.f ? 1 : 0;
+	}
+	RebuildAliasTable();
+}
+
+void FRoomSampler::RebuildAliasTable()
+{
+	const int32 Count = Weights.Num();
+	/** Summed again so removals can't accumulate rounding errors */
+	RemainingWeight = 0;
+	for (int32 Index = 0; Index < Count; Index++)
+	{
+		RemainingWeight += CanPick(Index) ? Weights[Index] : 0.f;
+	}
+	TableWeight = RemainingWeight;
+	if (Count == 0 || RemainingWeight <= 0)
+	{
+		return;
+	}
+
+	/** Vose's method over the rooms that are still available */
+	Small.Reset();
+	Large.Reset();
+	for (int32 Index = 0; Index < Count; Index++)
+	{
+		ScaledWeights[Index] = CanPick(Index) ? static_cast<float>(Weights[Index] * Count / RemainingWeight) : 0.f;
+		(ScaledWeights[Index] < 1.f ? Small : Large).Add(Index);
+	}
+	while (!Small.IsEmpty() && !Large.IsEmpty())
+	{
+		const int32 Less = Small.Pop(false);
+		const int32 More = Large.Pop(false);
+		Probabilities[Less] = ScaledWeights[Less];
+		Aliases[Less] = More;
+		ScaledWeights[More] = ScaledWeights[More] + ScaledWeights[Less] - 1.f;
+		(ScaledWeights[More] < 1.f ? Small : Large).Add(More);
+	}
+	/** Leftovers are only off from 1 by rounding */
+	for (const int32 Index : Large)
+	{
+		Probabilities[Index] = 1.f;
+		Aliases[Index] = Index;
+	}
+	for (const int32 Index : Small)
+	{
+		Probabilities[Index] = 1.f;
+		Aliases[Index] = Index;
+	}
+}
+
+int32 FRoomSampler::Sample(FMapRandomStream& Stream)
+{
+	if (RemainingCount == 0)
+	{
+		return INDEX_NONE;
+	}
+	for (;;)
+	{
+		const int32 Column = Stream.RandRange(0, Weights.Num() - 1);
+		const int32 Index = Stream.GetFraction() < Probabilities[Column] ? Column : Aliases[Column];
+		/** Rooms removed since the last rebuild are still in the table */
+		if (CanPick(Index))
+		{
+			return Index;
+		}
+	}
+}
+
+int32 FRoomSampler::SampleAndRemove(FMapRandomStream& Stream)
+{
+	if (RemainingCount == 0)
+	{
+		Restore();
+	}
+	const int32 Index = Sample(Stream);
+	if (Index != INDEX_NONE)
+	{
+		Remove(Index);
+	}
+	return Index;
+}
+
+void FRoomSampler::Remove(int32 Index)
+{
+	if (!Weights.IsValidIndex(Index) || !CanPick(Index))
+	{
+		return;
+	}
+	Removed[Index] = true;
+	RemainingCount--;
+	RemainingWeight -= Weights[Index];
+	if (RemainingCount > 0 && RemainingWeight * 2 < TableWeight)
+	{
+		RebuildAliasTable();
+	}
+}
+
+SIZE_T FRoomSampler::GetAllocatedSize() const
+{
+	return Weights.GetAllocatedSize() + Removed.GetAllocatedSize() + Probabilities.GetAllocatedSize() + Aliases.GetAllocatedSize()
+		+ ScaledWeights.GetAllocatedSize() + Small.GetAllocatedSize() + Large.GetAllocatedSize();
+}
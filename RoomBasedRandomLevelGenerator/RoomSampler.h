@@ -0,0 +1,46 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MapRandomStream.h"
+
+/**
+ * Weighted room picker using an alias table, every draw is O(1).
+ * Removed rooms stay out of every later draw until Restore, so uniqueness holds for a whole generation.
+ * Buffers are sized once in Build, drawing and removing never allocates.
+ */
+class PVD_API FRoomSampler
+{
+public:
+	/** Rooms with a weight of zero or less are never picked */
+	void Build(TConstArrayView<float> InWeights);
+	/** Puts every removed room back */
+	void Restore();
+
+	/** INDEX_NONE when nothing can be picked */
+	int32 Sample(FMapRandomStream& Stream);
+	/** Picks and removes, starts over with every room once all of them were picked */
+	int32 SampleAndRemove(FMapRandomStream& Stream);
+	void Remove(int32 Index);
+
+	FORCEINLINE int32 Num() const { return Weights.Num(); }
+	FORCEINLINE int32 NumRemaining() const { return RemainingCount; }
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	void RebuildAliasTable();
+	FORCEINLINE bool CanPick(int32 Index) const { return Weights[Index] > 0.f && !Removed[Index]; }
+
+	TArray<float> Weights;
+	TArray<bool> Removed;
+	TArray<float> Probabilities;
+	TArray<int32> Aliases;
+	/** Scratch for RebuildAliasTable */
+	TArray<float> ScaledWeights;
+	TArray<int32> Small;
+	TArray<int32> Large;
+
+	int32 RemainingCount = 0;
+	double RemainingWeight = 0;
+	/** Weight in the alias table, rebuilt once half of it was removed so draws reject at most half the time */
+	double TableWeight = 0;
+};
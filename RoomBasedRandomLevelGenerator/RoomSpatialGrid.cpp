@@ -0,0 +1,115 @@
+#include "../PCG/RoomSpatialGrid.h"
+
+FRoomSpatialGrid::FRoomSpatialGrid(float InCellSize)
+	: CellSize(FMath::Max(InCellSize, 1.f))
+{
+}
+
+void FRoomSpatialGrid::Reset(float InCellSize)
+{
+	CellSize = FMath::Max(InCellSize, 1.f);
+	EntryCount = 0;
+	Cells.Reset();
+	EntryBounds.Reset();
+	QueryStamps.Reset();
+	QueryStamp = 0;
+}
+
+FIntPoint FRoomSpatialGrid::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt32(Location.X / CellSize), FMath::FloorToInt32(Location.Y / CellSize));
+}
+
+void FRoomSpatialGrid::Insert(int32 Id, const FBox& Bounds)
+{
+	if (Id < 0 || !Bounds.IsValid)
+	{
+		return;
+	}
+	if (Id >= EntryBounds.Num())
+	{
+		EntryBounds.SetNum(Id + 1);
+		QueryStamps.SetNumZeroed(Id + 1);
+	}
+	EntryBounds[Id] = Bounds;
+	EntryCount++;
+
+	const FIntPoint MinCell = GetCell(Bounds.Min);
+	const FIntPoint MaxCell = GetCell(Bounds.Max);
+	for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+		{
+			Cells.FindOrAdd(FIntPoint(X, Y)).Add(Id);
+		}
+	}
+}
+
+void FRoomSpatialGrid::Remove(int32 Id)
+{
+	if (!EntryBounds.IsValidIndex(Id) || !EntryBounds[Id].IsValid)
+	{
+		return;
+	}
+	const FIntPoint MinCell = GetCell(EntryBounds[Id].Min);
+	const FIntPoint MaxCell = GetCell(EntryBounds[Id].Max);
+	for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+		{
+			if (TArray<int32>* CellEntries = Cells.Find(FIntPoint(X, Y)))
+			{
+				/** Keeps the order of the other entries, so queries report them the same way as before */
+				CellEntries->RemoveSingle(Id);
+			}
+		}
+	}
+	EntryBounds[Id] = FBox(ForceInit);
+	EntryCount--;
+}
+
+void FRoomSpatialGrid::Query(const FBox& Bounds, TArray<int32>& OutIds) const
+{
+	OutIds.Reset();
+	if (!Bounds.IsValid || EntryCount == 0)
+	{
+		return;
+	}
+	QueryStamp++;
+
+	const FIntPoint MinCell = GetCell(Bounds.Min);
+	const FIntPoint MaxCell = GetCell(Bounds.Max);
+	for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+		{
+			const TArray<int32>* CellEntries = Cells.Find(FIntPoint(X, Y));
+			if (CellEntries == nullptr)
+			{
+				continue;
+			}
+			for (const int32 Id : *CellEntries)
+			{
+				if (QueryStamps[Id] == QueryStamp)
+				{
+					continue;
+				}
+				QueryStamps[Id] = QueryStamp;
+				if (EntryBounds[Id].Intersect(Bounds))
+				{
+					OutIds.Add(Id);
+				}
+			}
+		}
+	}
+}
+
+SIZE_T FRoomSpatialGrid::GetAllocatedSize() const
+{
+	SIZE_T Size = Cells.GetAllocatedSize() + EntryBounds.GetAllocatedSize() + QueryStamps.GetAllocatedSize();
+	for (const auto& Cell : Cells)
+	{
+		Size += Cell.Value.GetAllocatedSize();
+	}
+	return Size;
+}
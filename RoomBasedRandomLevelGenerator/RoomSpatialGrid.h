@@ -0,0 +1,33 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Uniform grid over the XY plane used as broad phase for room bounds.
+ * Only cells that contain rooms are allocated, so far apart portal rooms cost nothing.
+ */
+class PVD_API FRoomSpatialGrid
+{
+public:
+	explicit FRoomSpatialGrid(float InCellSize = 4000.f);
+
+	void Reset(float InCellSize);
+	void Insert(int32 Id, const FBox& Bounds);
+	void Remove(int32 Id);
+	/** Ids whose bounds intersect the given bounds, every id is reported once */
+	void Query(const FBox& Bounds, TArray<int32>& OutIds) const;
+
+	FORCEINLINE int32 Num() const { return EntryCount; }
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	FIntPoint GetCell(const FVector& Location) const;
+
+	float CellSize;
+	int32 EntryCount = 0;
+	TMap<FIntPoint, TArray<int32>> Cells;
+	TArray<FBox> EntryBounds;
+	/** Per entry stamp of the last query that reported it */
+	mutable TArray<uint32> QueryStamps;
+	mutable uint32 QueryStamp = 0;
+};
@@ -0,0 +1,287 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "../PCG/RoomTemplateTable.h"
+
+#include "Room.h"
+#include "RoomEntrancePoint.h"
+#include "RoomExitPoint.h"
+#include "Components/BoxComponent.h"
+#include "Engine/BlueprintGeneratedClass.h"
+#include "Engine/SCS_Node.h"
+#include "Engine/SimpleConstructionScript.h"
+#include "PVD/PVD.h"
+#include "PVD/Data/PCGRoomContainer.h"
+#include "PVD/PCG/PuzzleRoomConnectionPoint.h"
+#include "UObject/ObjectSaveContext.h"
+
+namespace
+{
+	/** Component template with the name it gets on a spawned actor and the name of its attach parent */
+	struct FRoomComponentTemplate
+	{
+		const USceneComponent* Template = nullptr;
+		FName ParentName;
+	};
+
+	void CollectComponentTemplates(TSubclassOf<ARoom> RoomClass, TMap<FName, FRoomComponentTemplate>& OutTemplates, FName& OutRootName)
+	{
+		const ARoom* DefaultRoom = RoomClass->GetDefaultObject<ARoom>();
+
+		/** Native components, attachment is set up in the constructor */
+		TInlineComponentArray<USceneComponent*> NativeComponents;
+		DefaultRoom->GetComponents(NativeComponents);
+		for (const USceneComponent* Component : NativeComponents)
+		{
+			FRoomComponentTemplate& ComponentTemplate = OutTemplates.Add(Component->GetFName());
+			ComponentTemplate.Template = Component;
+			ComponentTemplate.ParentName = Component->GetAttachParent() ? Component->GetAttachParent()->GetFName() : NAME_None;
+		}
+		if (const USceneComponent* RootComponent = DefaultRoom->GetRootComponent())
+		{
+			OutRootName = RootComponent->GetFName();
+		}
+
+		/** Blueprint components, parents first so child classes override their templates */
+		TArray<const UBlueprintGeneratedClass*> BlueprintClasses;
+		UBlueprintGeneratedClass::GetGeneratedClassesHierarchy(RoomClass, BlueprintClasses);
+		const UBlueprintGeneratedClass* ActualClass = Cast<UBlueprintGeneratedClass>(RoomClass.Get());
+		for (int32 ClassIndex = BlueprintClasses.Num() - 1; ClassIndex >= 0; ClassIndex--)
+		{
+			const USimpleConstructionScript* ConstructionScript = BlueprintClasses[ClassIndex]->SimpleConstructionScript;
+			if (ConstructionScript == nullptr)
+			{
+				continue;
+			}
+			for (USCS_Node* Node : ConstructionScript->GetAllNodes())
+			{
+				const USceneComponent* Component = Cast<USceneComponent>(Node->GetActualComponentTemplate(const_cast<UBlueprintGeneratedClass*>(ActualClass)));
+				if (Component == nullptr)
+				{
+					continue;
+				}
+				FRoomComponentTemplate& ComponentTemplate = OutTemplates.Add(Node->GetVariableName());
+				ComponentTemplate.Template = Component;
+				if (const USCS_Node* ParentNode = ConstructionScript->FindParentNode(Node))
+				{
+					ComponentTemplate.ParentName = ParentNode->GetVariableName();
+				}
+				else if (Node->ParentComponentOrVariableName != NAME_None)
+				{
+					ComponentTemplate.ParentName = Node->ParentComponentOrVariableName;
+				}
+				else if (OutRootName == NAME_None)
+				{
+					OutRootName = Node->GetVariableName();
+				}
+				else
+				{
+					ComponentTemplate.ParentName = OutRootName;
+				}
+			}
+		}
+	}
+
+	/** Component transform relative to the actor, the root component's own transform is the actor transform */
+	FTransform GetComponentToActor(FName ComponentName, FName RootName, const TMap<FName, FRoomComponentTemplate>& Templates)
+	{
+		FTransform ComponentToActor = FTransform::Identity;
+		int32 Depth = 0;
+		while (ComponentName != NAME_None && ComponentName != RootName && Depth++ < 64)
+		{
+			const FRoomComponentTemplate* ComponentTemplate = Templates.Find(ComponentName);
+			if (ComponentTemplate == nullptr)
+			{
+				break;
+			}
+			ComponentToActor = ComponentToActor * ComponentTemplate->Template->GetRelativeTransform();
+			ComponentName = ComponentTemplate->ParentName;
+		}
+		return ComponentToActor;
+	}
+}
+
+FRoomFootprint FRoomTemplateData::ToFootprint() const
+{
+	FRoomFootprint Footprint;
+	Footprint.LocalBounds = LocalBounds;
+	Footprint.EntrancePoint = EntrancePoint;
+	Footprint.ExitPoints = ExitPoints;
+	Footprint.PuzzlePoints = PuzzlePoints;
+	Footprint.HasNavBox = HasNavBox;
+	Footprint.NavBoxTransform = NavBoxTransform;
+	Footprint.NavBoxExtent = NavBoxExtent;
+	return Footprint;
+}
+
+FRoomTemplateData URoomTemplateTable::BakeRoomTemplate(TSubclassOf<ARoom> RoomClass)
+{
+	FRoomTemplateData TemplateData;
+	TemplateData.RoomClass = RoomClass;
+	if (RoomClass == nullptr)
+	{
+		return TemplateData;
+	}
+
+	TMap<FName, FRoomComponentTemplate> ComponentTemplates;
+	FName RootName = NAME_None;
+	CollectComponentTemplates(RoomClass, ComponentTemplates, RootName);
+
+	const ARoom* DefaultRoom = RoomClass->GetDefaultObject<ARoom>();
+	const FName EntranceName = DefaultRoom->EntrancePoint ? DefaultRoom->EntrancePoint->GetFName() : NAME_None;
+	const FName NavBoxName = DefaultRoom->NavMeshContentsBox ? DefaultRoom->NavMeshContentsBox->GetFName() : NAME_None;
+
+	TArray<FName> ExitPointNames;
+	TArray<FName> PuzzlePointNames;
+	bool HasEntrance = false;
+	for (const auto& Pair : ComponentTemplates)
+	{
+		const USceneComponent* Component = Pair.Value.Template;
+		const FTransform ComponentToActor = GetComponentToActor(Pair.Key, RootName, ComponentTemplates);
+
+		if (const UPrimitiveComponent* Primitive = Cast<UPrimitiveComponent>(Component))
+		{
+			if (Primitive->GetCollisionEnabled() != ECollisionEnabled::NoCollision)
+			{
+				TemplateData.LocalBounds += Primitive->CalcBounds(ComponentToActor).GetBox();
+			}
+		}
+		if (Component->IsA<URoomExitPoint>())
+		{
+			ExitPointNames.Add(Pair.Key);
+		}
+		else if (Component->IsA<UPuzzleRoomConnectionPoint>())
+		{
+			PuzzlePointNames.Add(Pair.Key);
+		}
+		else if (Component->IsA<URoomEntrancePoint>() && (!HasEntrance || Pair.Key == EntranceName))
+		{
+			TemplateData.EntrancePoint = ComponentToActor;
+			HasEntrance = true;
+		}
+		if (const UBoxComponent* Box = Cast<UBoxComponent>(Component); Box && Pair.Key == NavBoxName)
+		{
+			TemplateData.HasNavBox = true;
+			TemplateData.NavBoxTransform = ComponentToActor;
+			TemplateData.NavBoxExtent = Box->GetUnscaledBoxExtent();
+		}
+	}
+
+	ExitPointNames.Sort(FNameLexicalLess());
+	for (const FName& ExitPointName : ExitPointNames)
+	{
+		TemplateData.ExitPoints.Add(GetComponentToActor(ExitPointName, RootName, ComponentTemplates));
+	}
+	PuzzlePointNames.Sort(FNameLexicalLess());
+	for (const FName& PuzzlePointName : PuzzlePointNames)
+	{
+		TemplateData.PuzzlePoints.Add(GetComponentToActor(PuzzlePointName, RootName, ComponentTemplates));
+	}
+
+	if (!HasEntrance)
+	{
+		PVD_LOG(Error, TEXT("Room %s has no entrance point!"), *RoomClass->GetName());
+	}
+	return TemplateData;
+}
+
+void URoomTemplateTable::Bake()
+{
+	Rebuild();
+	MarkPackageDirty();
+}
+
+void URoomTemplateTable::Rebuild()
+{
+	Templates.Reset();
+	TemplateLookup.Reset();
+	if (SourceContainer)
+	{
+		auto AddRooms = [this](const auto& RoomClasses)
+		{
+			for (const auto& RoomClass : RoomClasses)
+			{
+				FindOrBake(RoomClass);
+			}
+		};
+		AddRooms(SourceContainer->StartRooms);
+		AddRooms(SourceContainer->BattleRooms);
+		AddRooms(SourceContainer->PuzzleRooms);
+		AddRooms(SourceContainer->BossRooms);
+	}
+}
+
+const FRoomTemplateData* URoomTemplateTable::Find(TSubclassOf<ARoom> RoomClass) const
+{
+	const int32* TemplateIndex = TemplateLookup.Find(RoomClass.Get());
+	return TemplateIndex ? &Templates[*TemplateIndex] : nullptr;
+}
+
+const FRoomTemplateData& URoomTemplateTable::FindOrBake(TSubclassOf<ARoom> RoomClass)
+{
+	if (const FRoomTemplateData* TemplateData = Find(RoomClass))
+	{
+		return *TemplateData;
+	}
+	const int32 TemplateIndex = Templates.Add(BakeRoomTemplate(RoomClass));
+	TemplateLookup.Add(RoomClass.Get(), TemplateIndex);
+	return Templates[TemplateIndex];
+}
+
+float URoomTemplateTable::GetRoomWeight(TSubclassOf<ARoom> RoomClass) const
+{
+	const float* Weight = RoomWeights.Find(RoomClass);
+	return Weight ? *Weight : 1.f;
+}
+
+FMapLayoutTemplates URoomTemplateTable::MakeLayoutTemplates(int32 SafeRoomCount)
+{
+	FMapLayoutTemplates LayoutTemplates;
+	if (SourceContainer == nullptr)
+	{
+		return LayoutTemplates;
+	}
+
+	auto AddFootprints = [this](const auto& RoomClasses, TArray<FRoomFootprint>& OutFootprints)
+	{
+		for (const auto& RoomClass : RoomClasses)
+		{
+			FRoomFootprint& Footprint = OutFootprints.Add_GetRef(FindOrBake(RoomClass).ToFootprint());
+			Footprint.Weight = GetRoomWeight(RoomClass);
+		}
+	};
+	AddFootprints(SourceContainer->StartRooms, LayoutTemplates.StartRooms);
+	AddFootprints(SourceContainer->BattleRooms, LayoutTemplates.BattleRooms);
+	AddFootprints(SourceContainer->PuzzleRooms, LayoutTemplates.PuzzleRooms);
+	AddFootprints(SourceContainer->BossRooms, LayoutTemplates.BossRooms);
+	LayoutTemplates.BattleRoomPortalCount = SourceContainer->BattleRoomPortals.Num();
+	LayoutTemplates.PuzzleRoomPortalCount = SourceContainer->PuzzleRoomPortals.Num();
+	LayoutTemplates.SafeRoomPortalCount = SourceContainer->SafeRoomPortals.Num();
+	LayoutTemplates.SafeRoomCount = SafeRoomCount;
+	return LayoutTemplates;
+}
+
+void URoomTemplateTable::RebuildLookup()
+{
+	TemplateLookup.Reset();
+	for (int32 TemplateIndex = 0; TemplateIndex < Templates.Num(); TemplateIndex++)
+	{
+		TemplateLookup.Add(Templates[TemplateIndex].RoomClass.Get(), TemplateIndex);
+	}
+}
+
+void URoomTemplateTable::PostLoad()
+{
+	Super::PostLoad();
+	RebuildLookup();
+}
+
+void URoomTemplateTable::PreSave(FObjectPreSaveContext ObjectSaveContext)
+{
+	/** Cooked builds always ship a table matching the room classes they were cooked with */
+	if (ObjectSaveContext.IsCooking())
+	{
+		Rebuild();
+	}
+	Super::PreSave(ObjectSaveContext);
+}
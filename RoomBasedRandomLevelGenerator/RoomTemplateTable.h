@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MapLayoutSolver.h"
+#include "Engine/DataAsset.h"
+#include "RoomTemplateTable.generated.h"
+
+class ARoom;
+class UPCGRoomContainer;
+
+/** Baked geometry of one room class, everything placement needs without spawning the room */
+USTRUCT()
+struct FRoomTemplateData
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere)
+	TSubclassOf<ARoom> RoomClass;
+	UPROPERTY(VisibleAnywhere)
+	FBox LocalBounds{ForceInit};
+	UPROPERTY(VisibleAnywhere)
+	FTransform EntrancePoint;
+	/** Sorted by component name, same order AMapGenerator uses on spawned rooms */
+	UPROPERTY(VisibleAnywhere)
+	TArray<FTransform> ExitPoints;
+	UPROPERTY(VisibleAnywhere)
+	TArray<FTransform> PuzzlePoints;
+	UPROPERTY(VisibleAnywhere)
+	bool HasNavBox = false;
+	UPROPERTY(VisibleAnywhere)
+	FTransform NavBoxTransform;
+	UPROPERTY(VisibleAnywhere)
+	FVector NavBoxExtent = FVector::ZeroVector;
+
+	FRoomFootprint ToFootprint() const;
+};
+
+/**
+ * Flat table of room template data for every room class of a UPCGRoomContainer.
+ * Baked in the editor or on cook from the class defaults, no room actor is ever spawned for it.
+ */
+UCLASS(BlueprintType)
+class PVD_API URoomTemplateTable : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, Category="Room Templates")
+	UPCGRoomContainer* SourceContainer;
+	/** Relative chance of a room class to be picked, classes that aren't listed have a weight of 1 */
+	UPROPERTY(EditAnywhere, Category="Room Templates", meta=(ClampMin="0"))
+	TMap<TSubclassOf<ARoom>, float> RoomWeights;
+
+	/** Rebuilds the table from every room class of SourceContainer and marks the asset dirty */
+	UFUNCTION(CallInEditor, Category="Room Templates")
+	void Bake();
+	/** Same as Bake without touching the package, for transient tables and saving */
+	void Rebuild();
+
+	/** Baked data of the class, baked on demand if the table doesn't have it yet */
+	const FRoomTemplateData& FindOrBake(TSubclassOf<ARoom> RoomClass);
+	const FRoomTemplateData* Find(TSubclassOf<ARoom> RoomClass) const;
+
+	float GetRoomWeight(TSubclassOf<ARoom> RoomClass) const;
+
+	/** Solver input for SourceContainer, safe rooms are level actors so their count comes from the caller */
+	FMapLayoutTemplates MakeLayoutTemplates(int32 SafeRoomCount);
+
+	/** Reads the room geometry from the class default object and its construction script templates */
+	static FRoomTemplateData BakeRoomTemplate(TSubclassOf<ARoom> RoomClass);
+
+	virtual void PostLoad() override;
+	virtual void PreSave(FObjectPreSaveContext ObjectSaveContext) override;
+
+private:
+	void RebuildLookup();
+
+	UPROPERTY(VisibleAnywhere, Category="Room Templates")
+	TArray<FRoomTemplateData> Templates;
+
+	TMap<UClass*, int32> TemplateLookup;
+};